@@ -0,0 +1,387 @@
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BenchHarness.hpp"
+#include "sources/MagicalContainer.hpp"
+#include "sources/ShardedMagicalContainer.hpp"
+#include "sources/WorkloadGenerator.hpp"
+
+using namespace ariel;
+using namespace std;
+
+// Benchmark suite run by `make bench`:  ./benchmark [results.json]
+// `make bench-inline` runs only the 10M element traversals in both hot path builds:  ./benchmark --large [results.json]
+namespace
+{
+#ifdef MAGICAL_INLINE_ITERATORS
+    const string HOT_PATH = "inline";
+#else
+    const string HOT_PATH = "out-of-line";
+#endif
+    const size_t LARGE_SIZE = 10000000;
+    const size_t LARGE_TRAVERSALS = 5;
+    const size_t SIZES[] = {1000, 10000, 100000};
+    const size_t MUTATIONS = 100;  // timed addElement / removeElement calls per size
+    const size_t TRAVERSALS = 20;  // timed full traversals per view
+    const size_t BULK_LOADS = 5;   // timed bulk loads per size
+    const size_t BATCH_SIZES[] = {16, 256, 4096};
+    const size_t WORKLOAD_SIZE = 5000;  // initial elements of every mixed workload
+    const size_t WORKLOAD_OPS = 1000;   // operations per mixed workload
+    const size_t SEARCH_SIZES[] = {1000, 100000, 10000000};
+    const size_t SEARCHES = 100000;     // rank() queries per sample
+    const size_t SEARCH_SAMPLES = 10;
+    const size_t SHARD_COUNTS[] = {1, 2, 4, 8, 16};
+    const size_t INSERT_THREADS = 4;
+    const size_t INSERTS_PER_THREAD = 5000;
+    const size_t INSERT_SAMPLES = 3;
+    const Distribution DISTRIBUTIONS[] = {Distribution::Uniform, Distribution::Zipfian, Distribution::Presorted,
+                                          Distribution::ReverseSorted, Distribution::PrimeHeavy, Distribution::DuplicateHeavy};
+
+    vector<int> randomValues(size_t count, unsigned seed)
+    {
+        mt19937 random(seed);
+        uniform_int_distribution<int> values(-1000000, 1000000);
+        vector<int> result(count);
+        for (int &value : result)
+        {
+            value = values(random);
+        }
+        return result;
+    }
+
+    void benchMutations(bench::Harness &harness, size_t size)
+    {
+        vector<int> values = randomValues(size, 1);
+        vector<int> extra = randomValues(MUTATIONS, 2);
+
+        MagicalContainer container;
+        container.addElements(values);
+        vector<double> samples;
+        for (int value : extra)
+        {
+            samples.push_back(bench::timeNs([&]
+                                            { container.addElement(value); }));
+        }
+        harness.record("addElement", size, samples, 1);
+
+        samples.clear();
+        for (size_t i = 0; i < MUTATIONS; i++)
+        {
+            int value = values[i * values.size() / MUTATIONS];
+            samples.push_back(bench::timeNs([&]
+                                            { container.removeElement(value); }));
+        }
+        harness.record("removeElement", size, samples, 1);
+    }
+
+    void benchBulkLoad(bench::Harness &harness, size_t size)
+    {
+        vector<int> values = randomValues(size, 3);
+        vector<double> samples;
+        for (size_t i = 0; i < BULK_LOADS; i++)
+        {
+            MagicalContainer container;
+            samples.push_back(bench::timeNs([&]
+                                            { container.addElements(values); }));
+        }
+        harness.record("addElements (bulk load)", size, samples, size);
+    }
+
+    template <typename Iterator>
+    void benchTraversal(bench::Harness &harness, const string &name, MagicalContainer &container)
+    {
+        Iterator view(container);
+        if (view.size() == 0)
+            return;
+
+        long long checksum = 0;
+        vector<double> samples;
+        for (size_t i = 0; i < TRAVERSALS; i++)
+        {
+            samples.push_back(bench::timeNs([&]
+                                            {
+                for (auto it = view.begin(); it != view.end(); ++it)
+                {
+                    checksum += *it;
+                } }));
+        }
+        harness.record(name + " operator++", container.size(), samples, view.size());
+
+        samples.clear();
+        for (size_t i = 0; i < TRAVERSALS; i++)
+        {
+            samples.push_back(bench::timeNs([&]
+                                            {
+                for (auto it = view.begin(); it != std::default_sentinel; ++it)
+                {
+                    checksum += *it;
+                } }));
+        }
+        harness.record(name + " operator++ (sentinel)", container.size(), samples, view.size());
+
+        vector<int> buffer;
+        for (size_t batchSize : BATCH_SIZES)
+        {
+            buffer.resize(batchSize);
+            samples.clear();
+            for (size_t i = 0; i < TRAVERSALS; i++)
+            {
+                samples.push_back(bench::timeNs([&]
+                                                {
+                    Iterator it = view.begin();
+                    size_t count = 0;
+                    while ((count = it.nextBatch(buffer)) > 0)
+                    {
+                        for (size_t j = 0; j < count; j++)
+                        {
+                            checksum += buffer[j];
+                        }
+                    } }));
+            }
+            harness.record(name + " nextBatch(" + to_string(batchSize) + ")", container.size(), samples, view.size());
+        }
+        bench::keep(checksum);
+    }
+
+    template <typename ForEach>
+    void benchForEach(bench::Harness &harness, const string &name, const MagicalContainer &container, size_t viewSize, ForEach forEach)
+    {
+        if (viewSize == 0)
+            return;
+        long long checksum = 0;
+        vector<double> samples;
+        for (size_t i = 0; i < TRAVERSALS; i++)
+        {
+            samples.push_back(bench::timeNs([&]
+                                            { forEach(container, [&checksum](int value)
+                                                      { checksum += value; }); }));
+        }
+        harness.record(name, container.size(), samples, viewSize);
+        bench::keep(checksum);
+    }
+
+    template <typename Iterator, typename Backend>
+    long long traverse(Backend &container)
+    {
+        long long checksum = 0;
+        Iterator view(container);
+        for (auto it = view.begin(); it != view.end(); ++it)
+        {
+            checksum += *it;
+        }
+        return checksum;
+    }
+
+    // Runs the same generated operation mix against a backend, one latency sample per operation
+    template <typename Backend>
+    void benchWorkload(bench::Harness &harness, const string &backend, Distribution distribution)
+    {
+        WorkloadSpec spec;
+        spec.distribution = distribution;
+        spec.initialSize = WORKLOAD_SIZE;
+        spec.operations = WORKLOAD_OPS;
+        spec.valueRange = 1000000;
+        WorkloadGenerator generator(spec);
+
+        Backend container;
+        vector<int32_t> initial = generator.initialValues();
+        container.addElements(initial);
+
+        vector<double> adds, removes, scans;
+        long long checksum = 0;
+        TraceEvent event{};
+        while (generator.next(event))
+        {
+            switch (event.op)
+            {
+            case TraceOp::Add:
+                adds.push_back(bench::timeNs([&]
+                                             { container.addElement(event.value); }));
+                break;
+            case TraceOp::Remove:
+                removes.push_back(bench::timeNs([&]
+                                                { container.removeElement(event.value); }));
+                break;
+            case TraceOp::IterateAscending:
+                scans.push_back(bench::timeNs([&]
+                                              { checksum += traverse<typename Backend::AscendingIterator>(container); }));
+                break;
+            case TraceOp::IterateCross:
+                scans.push_back(bench::timeNs([&]
+                                              { checksum += traverse<typename Backend::SideCrossIterator>(container); }));
+                break;
+            case TraceOp::IteratePrime:
+                scans.push_back(bench::timeNs([&]
+                                              { checksum += traverse<typename Backend::PrimeIterator>(container); }));
+                break;
+            case TraceOp::IterateDescending:
+                if constexpr (requires { typename Backend::DescendingIterator; })
+                {
+                    scans.push_back(bench::timeNs([&]
+                                                  { checksum += traverse<typename Backend::DescendingIterator>(container); }));
+                }
+                else
+                { // no descending view (ShardedMagicalContainer), scan the same elements in ascending order
+                    scans.push_back(bench::timeNs([&]
+                                                  { checksum += traverse<typename Backend::AscendingIterator>(container); }));
+                }
+                break;
+            }
+        }
+        bench::keep(checksum);
+
+        string prefix = string(WorkloadGenerator::name(distribution)) + " " + backend;
+        harness.record(prefix + " add", WORKLOAD_SIZE, adds, 1);
+        harness.record(prefix + " remove", WORKLOAD_SIZE, removes, 1);
+        harness.record(prefix + " scan", WORKLOAD_SIZE, scans, 1);
+    }
+
+    // rank() as std::lower_bound over the sorted view against the Eytzinger search index
+    void benchSearch(bench::Harness &harness, size_t size)
+    {
+        MagicalContainer container;
+        container.addElements(randomValues(size, 6));
+        vector<int> queries = randomValues(SEARCHES, 7);
+
+        for (bool indexed : {false, true})
+        {
+            container.setSearchIndex(indexed);
+            size_t checksum = 0;
+            vector<double> samples;
+            for (size_t i = 0; i < SEARCH_SAMPLES; i++)
+            {
+                samples.push_back(bench::timeNs([&]
+                                                {
+                    for (int query : queries)
+                    {
+                        checksum += container.rank(query);
+                    } }));
+            }
+            harness.record(indexed ? "rank (Eytzinger index)" : "rank (std::lower_bound)", size, samples, queries.size());
+            bench::keep(static_cast<long long>(checksum));
+        }
+    }
+
+    // INSERT_THREADS threads calling addElement concurrently on one sharded container, timed until the
+    // last thread finishes, so ns/op is the inverse of the combined insert throughput
+    void benchShardedInserts(bench::Harness &harness, size_t shardCount)
+    {
+        vector<int> values = randomValues(INSERT_THREADS * INSERTS_PER_THREAD, 8);
+        vector<double> samples;
+        for (size_t i = 0; i < INSERT_SAMPLES; i++)
+        {
+            ShardedMagicalContainer container(shardCount);
+            samples.push_back(bench::timeNs([&]
+                                            {
+                vector<thread> workers;
+                for (size_t t = 0; t < INSERT_THREADS; t++)
+                {
+                    workers.emplace_back([&container, &values, t]
+                                         {
+                        for (size_t j = t * INSERTS_PER_THREAD; j < (t + 1) * INSERTS_PER_THREAD; j++)
+                        {
+                            container.addElement(values[j]);
+                        } });
+                }
+                for (thread &worker : workers)
+                {
+                    worker.join();
+                } }));
+        }
+        harness.record("Sharded addElement, " + to_string(INSERT_THREADS) + " threads, " + to_string(shardCount) + " shards",
+                       values.size(), samples, values.size());
+    }
+
+    // operator++ and operator* over 10M elements, the loop the inline hot path is for
+    template <typename Iterator>
+    void benchLargeTraversal(bench::Harness &harness, const string &name, MagicalContainer &container)
+    {
+        Iterator view(container);
+        long long checksum = 0;
+        vector<double> samples;
+        for (size_t i = 0; i < LARGE_TRAVERSALS; i++)
+        {
+            samples.push_back(bench::timeNs([&]
+                                            {
+                for (auto it = view.begin(); it != std::default_sentinel; ++it)
+                {
+                    checksum += *it;
+                } }));
+        }
+        harness.record(name + " operator++ (" + HOT_PATH + ")", container.size(), samples, view.size());
+        bench::keep(checksum);
+    }
+
+    void benchLarge(bench::Harness &harness)
+    {
+        MagicalContainer container;
+        container.addElements(randomValues(LARGE_SIZE, 5));
+        benchLargeTraversal<MagicalContainer::AscendingIterator>(harness, "AscendingIterator", container);
+        benchLargeTraversal<MagicalContainer::SideCrossIterator>(harness, "SideCrossIterator", container);
+        benchLargeTraversal<MagicalContainer::PrimeIterator>(harness, "PrimeIterator", container);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bool large = argc > 1 && string(argv[1]) == "--large";
+    int pathArgument = large ? 2 : 1;
+    string jsonPath = argc > pathArgument ? argv[pathArgument] : "bench_results.json";
+    bench::Harness harness;
+
+    if (large)
+    {
+        benchLarge(harness);
+        harness.printTable(cout);
+        ofstream json(jsonPath);
+        harness.writeJson(json);
+        cout << "results written to " << jsonPath << endl;
+        return 0;
+    }
+
+    for (size_t size : SIZES)
+    {
+        benchMutations(harness, size);
+        benchBulkLoad(harness, size);
+
+        MagicalContainer container;
+        container.addElements(randomValues(size, 4));
+        benchTraversal<MagicalContainer::AscendingIterator>(harness, "AscendingIterator", container);
+        benchTraversal<MagicalContainer::SideCrossIterator>(harness, "SideCrossIterator", container);
+        benchTraversal<MagicalContainer::PrimeIterator>(harness, "PrimeIterator", container);
+        benchTraversal<MagicalContainer::DescendingIterator>(harness, "DescendingIterator", container);
+
+        size_t primes = MagicalContainer::PrimeIterator(container).size();
+        benchForEach(harness, "forEachAscending", container, size, [](const MagicalContainer &c, auto f)
+                     { c.forEachAscending(f); });
+        benchForEach(harness, "forEachCross", container, size, [](const MagicalContainer &c, auto f)
+                     { c.forEachCross(f); });
+        benchForEach(harness, "forEachPrime", container, primes, [](const MagicalContainer &c, auto f)
+                     { c.forEachPrime(f); });
+    }
+
+    for (size_t size : SEARCH_SIZES)
+    {
+        benchSearch(harness, size);
+    }
+
+    for (size_t shardCount : SHARD_COUNTS)
+    {
+        benchShardedInserts(harness, shardCount);
+    }
+
+    for (Distribution distribution : DISTRIBUTIONS)
+    {
+        benchWorkload<MagicalContainer>(harness, "MagicalContainer", distribution);
+        benchWorkload<ShardedMagicalContainer>(harness, "ShardedMagicalContainer", distribution);
+    }
+
+    harness.printTable(cout);
+    ofstream json(jsonPath);
+    harness.writeJson(json);
+    cout << "results written to " << jsonPath << endl;
+    return 0;
+}
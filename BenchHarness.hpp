@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Minimal dependency-free benchmark harness: callers time samples, the harness keeps the
+// per-operation statistics and prints them as a table or as JSON.
+namespace bench
+{
+    struct Result
+    {
+        std::string name;
+        size_t size;       // container size the case ran against
+        size_t operations; // total operations over all samples
+        double nsPerOp;
+        double opsPerSec;
+        double p50; // ns per operation, median sample
+        double p99; // ns per operation, 99th percentile sample
+    };
+
+    // Wall time of one call in nanoseconds
+    template <typename Function>
+    double timeNs(Function f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+
+    // Consumes a checksum so the compiler cannot drop the loop that produced it: an empty asm
+    // statement that claims to read value, the usual benchmark-library barrier
+    inline void keep(long long value)
+    {
+#if defined(__GNUC__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        [[maybe_unused]] static volatile long long sink;
+        sink = value;
+#endif
+    }
+
+    inline double percentile(std::vector<double> sorted, double q)
+    {
+        if (sorted.empty())
+            return 0;
+        std::sort(sorted.begin(), sorted.end());
+        auto index = static_cast<size_t>(q * static_cast<double>(sorted.size() - 1) + 0.5);
+        return sorted[index];
+    }
+
+    class Harness
+    {
+        std::vector<Result> results;
+
+    public:
+        // sampleNs holds the duration of every sample, each of which ran opsPerSample operations
+        void record(const std::string &name, size_t size, const std::vector<double> &sampleNs, size_t opsPerSample)
+        {
+            if (sampleNs.empty() || opsPerSample == 0)
+                return;
+            std::vector<double> perOp;
+            double total = 0;
+            for (double ns : sampleNs)
+            {
+                perOp.push_back(ns / static_cast<double>(opsPerSample));
+                total += ns;
+            }
+            size_t operations = sampleNs.size() * opsPerSample;
+            double nsPerOp = total / static_cast<double>(operations);
+            results.push_back({name, size, operations, nsPerOp, 1e9 / nsPerOp, percentile(perOp, 0.5), percentile(perOp, 0.99)});
+        }
+
+        const std::vector<Result> &all() const { return results; }
+
+        void printTable(std::ostream &out) const
+        {
+            out << std::left << std::setw(44) << "case" << std::right << std::setw(10) << "size" << std::setw(14) << "ns/op"
+                << std::setw(16) << "ops/sec" << std::setw(14) << "p50" << std::setw(14) << "p99" << '\n';
+            out << std::fixed << std::setprecision(2);
+            for (const Result &result : results)
+            {
+                out << std::left << std::setw(44) << result.name << std::right << std::setw(10) << result.size << std::setw(14)
+                    << result.nsPerOp << std::setw(16) << result.opsPerSec << std::setw(14) << result.p50 << std::setw(14)
+                    << result.p99 << '\n';
+            }
+            out.unsetf(std::ios::fixed);
+        }
+
+        void writeJson(std::ostream &out) const
+        {
+            out << "{\n  \"results\": [\n";
+            for (size_t i = 0; i < results.size(); i++)
+            {
+                const Result &result = results[i];
+                out << "    {\"name\": \"" << result.name << "\", \"size\": " << result.size << ", \"operations\": "
+                    << result.operations << ", \"ns_per_op\": " << result.nsPerOp << ", \"ops_per_sec\": " << result.opsPerSec
+                    << ", \"p50_ns\": " << result.p50 << ", \"p99_ns\": " << result.p99 << "}"
+                    << (i + 1 < results.size() ? ",\n" : "\n");
+            }
+            out << "  ]\n}\n";
+        }
+    };
+} // namespace bench
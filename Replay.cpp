@@ -0,0 +1,161 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "BenchHarness.hpp"
+#include "sources/MagicalContainer.hpp"
+#include "sources/WorkloadTrace.hpp"
+
+using namespace ariel;
+using namespace std;
+
+// Replays a workload trace against a fresh MagicalContainer at full speed and reports
+// throughput and latency percentiles per operation.
+//
+//   ./replay <trace>               replay a recorded trace
+//   ./replay --record-demo <trace> record the Demo.cpp workload as a sample trace
+namespace
+{
+    void recordDemo(const string &path)
+    {
+        TraceWriter writer(path);
+        MagicalContainer container;
+        container.attachTrace(&writer);
+        for (int element : {17, 2, 25, 9, 3})
+        {
+            container.addElement(element);
+        }
+
+        long long checksum = 0;
+        MagicalContainer::AscendingIterator ascIter(container);
+        for (auto it = ascIter.begin(); it != ascIter.end(); ++it)
+        {
+            checksum += *it;
+        }
+        MagicalContainer::SideCrossIterator crossIter(container);
+        for (auto it = crossIter.begin(); it != crossIter.end(); ++it)
+        {
+            checksum += *it;
+        }
+        MagicalContainer::PrimeIterator primeIter(container);
+        for (auto it = primeIter.begin(); it != primeIter.end(); ++it)
+        {
+            checksum += *it;
+        }
+        container.removeElement(9);
+        bench::keep(checksum);
+
+        writer.flush();
+        cout << "recorded " << writer.recorded() << " operations to " << path << endl;
+    }
+
+    template <typename Iterator>
+    long long traverse(MagicalContainer &container)
+    {
+        long long checksum = 0;
+        Iterator view(container);
+        for (auto it = view.begin(); it != view.end(); ++it)
+        {
+            checksum += *it;
+        }
+        return checksum;
+    }
+
+    const char *opName(TraceOp op)
+    {
+        switch (op)
+        {
+        case TraceOp::Add:
+            return "add";
+        case TraceOp::Remove:
+            return "remove";
+        case TraceOp::IterateAscending:
+            return "iterate ascending";
+        case TraceOp::IterateCross:
+            return "iterate cross";
+        case TraceOp::IteratePrime:
+            return "iterate prime";
+        default:
+            return "iterate descending";
+        }
+    }
+
+    void replay(const string &path)
+    {
+        vector<TraceEvent> events = TraceReader::readAll(path);
+        MagicalContainer container;
+        vector<vector<double>> samples(static_cast<size_t>(TraceOp::IterateDescending) + 1);
+        size_t failures = 0;
+        long long checksum = 0;
+
+        double totalNs = bench::timeNs([&]
+                                       {
+            for (const TraceEvent &event : events)
+            {
+                double ns = bench::timeNs([&]
+                                          {
+                    try
+                    {
+                        switch (event.op)
+                        {
+                        case TraceOp::Add:
+                            container.addElement(event.value);
+                            break;
+                        case TraceOp::Remove:
+                            container.removeElement(event.value);
+                            break;
+                        case TraceOp::IterateAscending:
+                            checksum += traverse<MagicalContainer::AscendingIterator>(container);
+                            break;
+                        case TraceOp::IterateCross:
+                            checksum += traverse<MagicalContainer::SideCrossIterator>(container);
+                            break;
+                        case TraceOp::IteratePrime:
+                            checksum += traverse<MagicalContainer::PrimeIterator>(container);
+                            break;
+                        case TraceOp::IterateDescending:
+                            checksum += traverse<MagicalContainer::DescendingIterator>(container);
+                            break;
+                        }
+                    }
+                    catch (const std::runtime_error &)
+                    {
+                        ++failures; // e.g. removing a value the recorded run never held
+                    } });
+                samples[static_cast<size_t>(event.op)].push_back(ns);
+            } });
+        bench::keep(checksum);
+
+        bench::Harness harness;
+        for (size_t op = 0; op < samples.size(); op++)
+        {
+            harness.record(opName(static_cast<TraceOp>(op)), container.size(), samples[op], 1);
+        }
+        harness.printTable(cout);
+        cout << events.size() << " operations in " << totalNs / 1e6 << " ms, "
+             << static_cast<double>(events.size()) * 1e9 / totalNs << " ops/sec, " << failures << " failed" << endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        if (argc == 3 && string(argv[1]) == "--record-demo")
+        {
+            recordDemo(argv[2]);
+            return 0;
+        }
+        if (argc == 2)
+        {
+            replay(argv[1]);
+            return 0;
+        }
+        cerr << "usage: " << argv[0] << " <trace> | --record-demo <trace>" << endl;
+        return 2;
+    }
+    catch (const std::exception &error)
+    {
+        cerr << error.what() << endl;
+        return 1;
+    }
+}
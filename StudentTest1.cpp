@@ -1,9 +1,72 @@
 #include "doctest.h"
 #include "sources/MagicalContainer.hpp"
+#include "sources/ShardedMagicalContainer.hpp"
+#include "sources/ParallelAlgorithms.hpp"
+#include "sources/MappedMagicalContainer.hpp"
+#include "sources/StreamLoader.hpp"
+#include "sources/LatencyHistogram.hpp"
+#include "sources/WorkloadTrace.hpp"
+#include "sources/WorkloadGenerator.hpp"
+#include "sources/IteratorChecks.hpp"
 #include <stdexcept>
+#include <set>
+#include <atomic>
+#include <fstream>
+#include <cstdio>
+#include <sstream>
+#include <thread>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <type_traits>
 
 using namespace ariel;
 using namespace std;
+
+#if !MAGICAL_CHECKED_ITERATORS
+#error "The tests expect iterator misuse to throw, build them without UNCHECKED"
+#endif
+
+// Global allocation counters for the allocation tests. Counted per thread, so thread pool
+// workers and loader threads running in the background do not disturb a measurement.
+namespace
+{
+    thread_local uint64_t allocationCount = 0;
+
+    uint64_t allocationsDuring(const function<void()> &body) {
+        uint64_t before = allocationCount;
+        body();
+        return allocationCount - before;
+    }
+}
+
+void *operator new(size_t size) {
+    ++allocationCount;
+    if (void *memory = malloc(size == 0 ? 1 : size))
+        return memory;
+    throw bad_alloc();
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+    free(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+    free(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept {
+    free(memory);
+}
 // Test case for adding elements to the MagicalContainer
 TEST_CASE("Adding elements to MagicalContainer") {
     MagicalContainer container;
@@ -597,3 +660,1454 @@ TEST_CASE("operator= throws when iterators are pointing at different containers"
 }
 
 
+
+TEST_CASE("ShardedMagicalContainer") {
+    ShardedMagicalContainer sharded(4);
+    MagicalContainer reference;
+    int values[] = {17, 2, 25, 9, 3, 8, 8, 1, 40, 13, -5, 11};
+    for (int value : values) {
+        sharded.addElement(value);
+        reference.addElement(value);
+    }
+    CHECK(sharded.size() == reference.size());
+    CHECK(sharded.shardCount() == 4);
+    CHECK_THROWS_AS(ShardedMagicalContainer(0), invalid_argument);
+
+    SUBCASE("AscendingIterator merges the shards") {
+        ShardedMagicalContainer::AscendingIterator it(sharded);
+        MagicalContainer::AscendingIterator expected(reference);
+        auto exp = expected.begin();
+        for (auto cur = it.begin(); cur != it.end(); ++cur, ++exp) {
+            CHECK(*cur == *exp);
+        }
+        CHECK(exp == expected.end());
+        CHECK_THROWS_AS(++it.end(), runtime_error);
+    }
+
+    SUBCASE("SideCrossIterator matches the unsharded cross order") {
+        ShardedMagicalContainer::SideCrossIterator it(sharded);
+        MagicalContainer::SideCrossIterator expected(reference);
+        auto exp = expected.begin();
+        for (auto cur = it.begin(); cur != it.end(); ++cur, ++exp) {
+            CHECK(*cur == *exp);
+        }
+        CHECK(exp == expected.end());
+    }
+
+    SUBCASE("PrimeIterator visits every prime once") {
+        ShardedMagicalContainer::PrimeIterator it(sharded);
+        multiset<int> primes;
+        for (auto cur = it.begin(); cur != it.end(); ++cur) {
+            primes.insert(*cur);
+        }
+        CHECK(primes == multiset<int>{2, 3, 11, 13, 17});
+    }
+
+    SUBCASE("Removing an element") {
+        sharded.removeElement(8);
+        CHECK(sharded.size() == reference.size() - 1);
+        CHECK_THROWS_AS(sharded.removeElement(1000), runtime_error);
+    }
+
+    SUBCASE("Sentinel loops match end() loops") {
+        ShardedMagicalContainer::AscendingIterator ascending(sharded);
+        ShardedMagicalContainer::SideCrossIterator cross(sharded);
+        ShardedMagicalContainer::PrimeIterator prime(sharded);
+        vector<int> byEnd, bySentinel;
+        for (auto it = ascending.begin(); it != ascending.end(); ++it) byEnd.push_back(*it);
+        for (auto it = cross.begin(); it != cross.end(); ++it) byEnd.push_back(*it);
+        for (auto it = prime.begin(); it != prime.end(); ++it) byEnd.push_back(*it);
+        for (auto it = ascending.begin(); it != default_sentinel; ++it) bySentinel.push_back(*it);
+        for (auto it = cross.begin(); it != default_sentinel; ++it) bySentinel.push_back(*it);
+        for (auto it = prime.begin(); it != default_sentinel; ++it) bySentinel.push_back(*it);
+        CHECK(bySentinel == byEnd);
+        CHECK(byEnd.size() == 2 * reference.size() + 5);
+        CHECK(ascending.end() == default_sentinel);
+        CHECK(cross.end() == default_sentinel);
+        CHECK(prime.end() == default_sentinel);
+        CHECK_THROWS_AS(*cross.end(), runtime_error);
+    }
+
+    SUBCASE("end() does not allocate") {
+        ShardedMagicalContainer::AscendingIterator ascending(sharded);
+        ShardedMagicalContainer::SideCrossIterator cross(sharded);
+        size_t allocations = allocationsDuring([&] {
+            for (auto it = ascending.begin(); it != ascending.end(); ++it) {}
+            for (auto it = cross.begin(); it != cross.end(); ++it) {}
+        });
+        CHECK(allocations <= 6); // the begin() copies only, none per element
+    }
+}
+
+TEST_CASE("Sharded views follow the live container") {
+    ShardedMagicalContainer sharded(4);
+    ShardedMagicalContainer::AscendingIterator ascending(sharded);
+    ShardedMagicalContainer::SideCrossIterator cross(sharded);
+    ShardedMagicalContainer::PrimeIterator prime(sharded);
+    sharded.addElement(5);
+    sharded.addElement(3);
+    sharded.addElement(7);
+    sharded.addElement(8);
+
+    auto collect = [](auto &view) {
+        vector<int> values;
+        for (auto it = view.begin(); it != view.end(); ++it) {
+            values.push_back(*it);
+        }
+        return values;
+    };
+    CHECK(collect(ascending) == vector<int>{3, 5, 7, 8});
+    CHECK(collect(cross) == vector<int>{3, 8, 5, 7});
+    CHECK(collect(prime).size() == 3);
+
+    sharded.removeElement(5);
+    CHECK(collect(ascending) == vector<int>{3, 7, 8});
+    CHECK(collect(cross) == vector<int>{3, 8, 7});
+    CHECK(collect(prime).size() == 2);
+}
+
+TEST_CASE("ShardedMagicalContainer concurrent inserts") {
+    const int threads = 8;
+    const int perThread = 2000;
+    ShardedMagicalContainer sharded(4);
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&sharded, t] {
+            for (int i = 0; i < perThread; i++) {
+                sharded.addElement(i * threads + t); // every thread adds its own residue class
+            }
+            for (int i = 0; i < perThread; i += 2) {
+                sharded.removeElement(i * threads + t);
+            }
+        });
+    }
+    for (thread &worker : workers) {
+        worker.join();
+    }
+
+    CHECK(sharded.size() == threads * perThread / 2);
+    vector<int> values;
+    ShardedMagicalContainer::AscendingIterator ascending(sharded);
+    for (auto it = ascending.begin(); it != default_sentinel; ++it) {
+        values.push_back(*it);
+    }
+    vector<int> expected;
+    for (int i = 1; i < perThread; i += 2) {
+        for (int t = 0; t < threads; t++) {
+            expected.push_back(i * threads + t);
+        }
+    }
+    CHECK(values == expected);
+}
+
+TEST_CASE("Parallel algorithms over views") {
+    MagicalContainer container;
+    long long expectedSum = 0;
+    for (int i = 1; i <= 500; i++) {
+        container.addElement(i);
+        expectedSum += i;
+    }
+    ThreadPool pool(4);
+
+    SUBCASE("parallel_for_each visits every element once") {
+        MagicalContainer::AscendingIterator it(container);
+        atomic<long long> sum(0);
+        parallel_for_each(it, [&](int value) { sum += value; }, pool);
+        CHECK(sum == expectedSum);
+    }
+
+    SUBCASE("parallel_reduce starts at the iterator position") {
+        MagicalContainer::AscendingIterator it(container);
+        ++it;
+        ++it;
+        long long sum = parallel_reduce(it, 0LL, [](long long a, long long b) { return a + b; }, pool);
+        CHECK(sum == expectedSum - 1 - 2);
+    }
+
+    SUBCASE("parallel_reduce over primes and cross order") {
+        MagicalContainer::PrimeIterator primes(container);
+        int primeSum = 0;
+        for (auto it = primes.begin(); it != primes.end(); ++it) {
+            primeSum += *it;
+        }
+        CHECK(parallel_reduce(primes, 0, [](int a, int b) { return a + b; }, pool) == primeSum);
+        MagicalContainer::SideCrossIterator cross(container);
+        CHECK(parallel_reduce(cross, 0, [](int a, int b) { return max(a, b); }, pool) == 500);
+    }
+
+    SUBCASE("exceptions reach the caller") {
+        MagicalContainer::AscendingIterator it(container);
+        CHECK_THROWS_AS(parallel_for_each(it, [](int value) { if (value == 250) throw runtime_error("boom"); }, pool), runtime_error);
+    }
+
+    SUBCASE("empty view") {
+        MagicalContainer empty;
+        MagicalContainer::PrimeIterator it(empty);
+        CHECK(parallel_reduce(it, 7, [](int a, int b) { return a + b; }, pool) == 7);
+    }
+}
+
+TEST_CASE("Splitting iterators into sub-ranges") {
+    MagicalContainer container;
+    for (int i = 1; i <= 10; i++) {
+        container.addElement(i);
+    }
+
+    SUBCASE("split covers the remaining view in order") {
+        MagicalContainer::AscendingIterator it(container);
+        ++it;
+        auto ranges = it.split(3);
+        CHECK(ranges.size() == 3);
+        int expected = 2;
+        size_t total = 0;
+        for (auto &range : ranges) {
+            CHECK(range.size() >= 3);
+            total += range.size();
+            for (int value : range) {
+                CHECK(value == expected++);
+            }
+        }
+        CHECK(total == 9);
+        CHECK(ranges.back().end() == it.end());
+        CHECK_THROWS_AS(it.split(0), invalid_argument);
+    }
+
+    SUBCASE("split into more parts than elements") {
+        MagicalContainer::PrimeIterator it(container);
+        auto ranges = it.split(8);
+        size_t total = 0;
+        for (auto &range : ranges) {
+            total += range.size();
+        }
+        CHECK(total == 4);
+    }
+
+    SUBCASE("trySplit halves a range") {
+        MagicalContainer::SideCrossIterator it(container);
+        auto range = it.split(1).front();
+        auto prefix = range.trySplit();
+        REQUIRE(prefix.has_value());
+        CHECK(prefix->size() == 5);
+        CHECK(range.size() == 5);
+        CHECK(*prefix->begin() == 1);
+        CHECK(*range.begin() == *it.atPosition(5));
+        auto single = it.atPosition(9);
+        SubRange<MagicalContainer::SideCrossIterator> last(single, it.end());
+        CHECK_FALSE(last.trySplit().has_value());
+    }
+}
+
+TEST_CASE("nextBatch copies the view in blocks") {
+    MagicalContainer container;
+    for (int i = 10; i >= 1; i--) {
+        container.addElement(i);
+    }
+    int buffer[4];
+
+    SUBCASE("AscendingIterator") {
+        MagicalContainer::AscendingIterator it(container);
+        CHECK(it.nextBatch(buffer) == 4);
+        CHECK(buffer[0] == 1);
+        CHECK(buffer[3] == 4);
+        CHECK(*it == 5);
+        CHECK(it.nextBatch(buffer) == 4);
+        CHECK(it.nextBatch(buffer) == 2);
+        CHECK(buffer[1] == 10);
+        CHECK(it == it.end());
+        CHECK(it.nextBatch(buffer) == 0);
+    }
+
+    SUBCASE("SideCrossIterator") {
+        MagicalContainer::SideCrossIterator it(container);
+        CHECK(it.nextBatch(buffer) == 4);
+        CHECK(buffer[0] == 1);
+        CHECK(buffer[1] == 10);
+        CHECK(buffer[2] == 2);
+        CHECK(buffer[3] == 9);
+    }
+
+    SUBCASE("PrimeIterator") {
+        MagicalContainer::PrimeIterator it(container);
+        CHECK(it.nextBatch(span<int>(buffer, 3)) == 3);
+        CHECK(it.nextBatch(buffer) == 1);
+        CHECK(it == it.end());
+    }
+}
+
+TEST_CASE("Internal iteration over views") {
+    MagicalContainer container;
+    container.addElement(17);
+    container.addElement(2);
+    container.addElement(25);
+    container.addElement(9);
+    container.addElement(3);
+
+    vector<int> visited;
+    auto collect = [&visited](int value) { visited.push_back(value); };
+
+    SUBCASE("forEachAscending") {
+        container.forEachAscending(collect);
+        CHECK(visited == vector<int>{2, 3, 9, 17, 25});
+    }
+
+    SUBCASE("forEachCross") {
+        container.forEachCross(collect);
+        CHECK(visited == vector<int>{2, 25, 3, 17, 9});
+    }
+
+    SUBCASE("forEachPrime") {
+        container.forEachPrime(collect);
+        CHECK(visited == vector<int>{17, 2, 3});
+    }
+
+    SUBCASE("Empty container") {
+        MagicalContainer empty;
+        empty.forEachAscending(collect);
+        empty.forEachCross(collect);
+        empty.forEachPrime(collect);
+        CHECK(visited.empty());
+    }
+}
+
+TEST_CASE("Snapshot save and load") {
+    MagicalContainer container;
+    int values[] = {17, 2, 25, 9, 3, -4, 13};
+    for (int value : values) {
+        container.addElement(value);
+    }
+    const string path = "test_snapshot.bin";
+    container.save(path);
+
+    SUBCASE("Loaded container has the same views") {
+        MagicalContainer loaded;
+        loaded.addElement(1000); // replaced by load
+        loaded.load(path);
+        CHECK(loaded == container);
+        CHECK(loaded.size() == container.size());
+
+        vector<int> expected, actual;
+        container.forEachAscending([&](int value) { expected.push_back(value); });
+        loaded.forEachAscending([&](int value) { actual.push_back(value); });
+        CHECK(actual == expected);
+
+        expected.clear(), actual.clear();
+        container.forEachCross([&](int value) { expected.push_back(value); });
+        loaded.forEachCross([&](int value) { actual.push_back(value); });
+        CHECK(actual == expected);
+
+        expected.clear(), actual.clear();
+        container.forEachPrime([&](int value) { expected.push_back(value); });
+        loaded.forEachPrime([&](int value) { actual.push_back(value); });
+        CHECK(actual == expected);
+
+        loaded.removeElement(17);
+        CHECK(loaded.size() == 6);
+    }
+
+    SUBCASE("Invalid files are rejected") {
+        MagicalContainer loaded;
+        loaded.addElement(5);
+        CHECK_THROWS_AS(loaded.load("missing_snapshot.bin"), runtime_error);
+        {
+            ofstream out(path, ios::binary | ios::app);
+            out << 'x';
+        }
+        CHECK_THROWS_AS(loaded.load(path), runtime_error);
+        CHECK(loaded.size() == 1); // untouched by the failed load
+    }
+
+    SUBCASE("Inconsistent views are rejected") {
+        // elements {17, 2, 25, 9, 3, -4, 13}, sorted indexes {5, 1, 4, 3, 6, 0, 2}, prime indexes {0, 1, 4, 6}
+        const streamoff elementsAt = sizeof(SnapshotHeader);
+        const streamoff sortedAt = elementsAt + 7 * sizeof(int32_t);
+        const streamoff primesAt = sortedAt + 7 * sizeof(uint32_t);
+        auto patch = [&path](streamoff offset, uint32_t value) {
+            fstream file(path, ios::binary | ios::in | ios::out);
+            file.seekp(offset);
+            file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        };
+        // rewrites the header checksum to match the patched sections, so only the view checks can object
+        auto reseal = [&path]() {
+            fstream file(path, ios::binary | ios::in | ios::out);
+            SnapshotHeader header{};
+            file.read(reinterpret_cast<char *>(&header), sizeof(header));
+            vector<int32_t> elements(header.elementCount);
+            vector<uint32_t> sorted(header.elementCount), primes(header.primeCount);
+            file.read(reinterpret_cast<char *>(elements.data()), static_cast<streamsize>(elements.size() * 4));
+            file.read(reinterpret_cast<char *>(sorted.data()), static_cast<streamsize>(sorted.size() * 4));
+            file.read(reinterpret_cast<char *>(primes.data()), static_cast<streamsize>(primes.size() * 4));
+            header.checksum = snapshotChecksum(elements, sorted, primes);
+            file.seekp(0);
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        };
+        MagicalContainer loaded;
+        loaded.addElement(5);
+
+        SUBCASE("Corrupted element") {
+            patch(elementsAt, 18);
+            CHECK_THROWS_AS(loaded.load(path), runtime_error);
+        }
+        SUBCASE("Repeated sorted index") {
+            for (streamoff i = 0; i < 7; i++) {
+                patch(sortedAt + i * 4, 2);
+            }
+            reseal();
+            CHECK_THROWS_AS(loaded.load(path), runtime_error);
+        }
+        SUBCASE("Sorted view out of order") {
+            patch(sortedAt, 1);
+            patch(sortedAt + 4, 5);
+            reseal();
+            CHECK_THROWS_AS(loaded.load(path), runtime_error);
+        }
+        SUBCASE("Prime view out of order") {
+            patch(primesAt + 4, 4);
+            reseal();
+            CHECK_THROWS_AS(loaded.load(path), runtime_error);
+        }
+        SUBCASE("Wrong primes are caught only when verifying them") {
+            patch(primesAt + 2 * 4, 3); // 9 listed instead of 3
+            reseal();
+            CHECK_THROWS_AS(loaded.load(path, true), runtime_error);
+            MagicalContainer trusting;
+            trusting.load(path);
+            CHECK(trusting.size() == 7);
+        }
+        CHECK(loaded.size() == 1);
+        CHECK(loaded.contains(5));
+    }
+
+    SUBCASE("verifyPrimes accepts a correct snapshot") {
+        MagicalContainer loaded;
+        loaded.load(path, true);
+        CHECK(loaded == container);
+    }
+
+    remove(path.c_str());
+}
+
+TEST_CASE("MappedMagicalContainer") {
+    MagicalContainer container;
+    int values[] = {17, 2, 25, 9, 3, -4, 13, 8};
+    for (int value : values) {
+        container.addElement(value);
+    }
+    const string path = "test_mapped.bin";
+    container.save(path);
+
+    MappedMagicalContainer mapped(path);
+    CHECK(mapped.size() == container.size());
+
+    SUBCASE("Views match the original container") {
+        vector<int> expected, actual;
+        container.forEachAscending([&](int value) { expected.push_back(value); });
+        MappedMagicalContainer::AscendingIterator ascending(mapped);
+        for (auto it = ascending.begin(); it != ascending.end(); ++it) {
+            actual.push_back(*it);
+        }
+        CHECK(actual == expected);
+
+        expected.clear(), actual.clear();
+        container.forEachCross([&](int value) { expected.push_back(value); });
+        MappedMagicalContainer::SideCrossIterator cross(mapped);
+        for (auto it = cross.begin(); it != cross.end(); ++it) {
+            actual.push_back(*it);
+        }
+        CHECK(actual == expected);
+
+        expected.clear(), actual.clear();
+        container.forEachPrime([&](int value) { expected.push_back(value); });
+        MappedMagicalContainer::PrimeIterator prime(mapped);
+        for (auto it = prime.begin(); it != prime.end(); ++it) {
+            actual.push_back(*it);
+        }
+        CHECK(actual == expected);
+        CHECK_THROWS_AS(*prime.end(), runtime_error);
+    }
+
+    SUBCASE("Works with the parallel algorithms and moves") {
+        MappedMagicalContainer moved(std::move(mapped));
+        MappedMagicalContainer::AscendingIterator ascending(moved);
+        CHECK(parallel_reduce(ascending, 0, [](int a, int b) { return a + b; }) == 73);
+        MappedMagicalContainer::AscendingIterator other(mapped);
+        CHECK_THROWS_AS((void)(ascending == other), invalid_argument);
+    }
+
+    SUBCASE("Invalid files are rejected") {
+        CHECK_THROWS_AS(MappedMagicalContainer("missing_snapshot.bin"), runtime_error);
+        {
+            ofstream out(path, ios::binary | ios::trunc);
+            out << "not a snapshot file at all, just text";
+        }
+        CHECK_THROWS_AS(MappedMagicalContainer(path.c_str()), runtime_error);
+    }
+
+    SUBCASE("Saving over a mapped file leaves the mapping intact") {
+        MagicalContainer smaller;
+        smaller.addElement(1);
+        smaller.save(path); // would shrink the mapped file under a truncating save
+        MappedMagicalContainer::AscendingIterator ascending(mapped);
+        long long sum = 0;
+        for (auto it = ascending.begin(); it != ascending.end(); ++it) {
+            sum += *it;
+        }
+        CHECK(sum == 73);
+        CHECK(MappedMagicalContainer(path).size() == 1);
+        CHECK_FALSE(ifstream(path + ".tmp").good());
+    }
+
+    SUBCASE("Validating open rejects inconsistent views") {
+        CHECK(MappedMagicalContainer(path, true).size() == container.size());
+        {
+            fstream file(path, ios::binary | ios::in | ios::out);
+            file.seekp(static_cast<streamoff>(sizeof(SnapshotHeader) + 8 * sizeof(int32_t)));
+            uint32_t outOfRange = 1000;
+            file.write(reinterpret_cast<const char *>(&outOfRange), sizeof(outOfRange));
+        }
+        CHECK(MappedMagicalContainer(path).size() == container.size()); // trusted by default
+        CHECK_THROWS_AS(MappedMagicalContainer(path, true), runtime_error);
+    }
+
+    remove(path.c_str());
+}
+
+TEST_CASE("Streaming ingestion") {
+    const string path = "test_stream.txt";
+    MagicalContainer expected;
+    for (int i = 0; i < 300; i++) {
+        expected.addElement((i * 7919) % 1009 - 500);
+    }
+
+    SUBCASE("Text input split across tiny blocks") {
+        {
+            ofstream out(path);
+            expected.forEachCross([&](int value) { out << value << (value % 3 == 0 ? "\n" : "  "); });
+        }
+        MagicalContainer loaded;
+        loaded.addElement(42);
+        StreamLoader::Options options;
+        options.blockSize = 7;
+        options.queueDepth = 2;
+        CHECK(StreamLoader::loadFile(loaded, path, options) == 300);
+        CHECK(loaded.size() == 301);
+        loaded.removeElement(42);
+
+        vector<int> want, got;
+        expected.forEachAscending([&](int value) { want.push_back(value); });
+        loaded.forEachAscending([&](int value) { got.push_back(value); });
+        CHECK(got == want);
+
+        want.clear(), got.clear();
+        expected.forEachCross([&](int value) { want.push_back(value); });
+        loaded.forEachCross([&](int value) { got.push_back(value); });
+        CHECK(got == want);
+
+        size_t primes = 0;
+        loaded.forEachPrime([&](int) { primes++; });
+        size_t expectedPrimes = 0;
+        expected.forEachPrime([&](int) { expectedPrimes++; });
+        CHECK(primes == expectedPrimes);
+    }
+
+    SUBCASE("Binary input") {
+        vector<int> values = {5, -3, 11, 8, 2};
+        {
+            ofstream out(path, ios::binary);
+            out.write(reinterpret_cast<const char *>(values.data()), static_cast<streamsize>(values.size() * sizeof(int)));
+        }
+        MagicalContainer loaded;
+        StreamLoader::Options options;
+        options.format = StreamLoader::Format::Binary;
+        options.blockSize = 6;
+        CHECK(StreamLoader::loadFile(loaded, path, options) == 5);
+        vector<int> got, primes;
+        loaded.forEachAscending([&](int value) { got.push_back(value); });
+        loaded.forEachPrime([&](int value) { primes.push_back(value); });
+        CHECK(got == vector<int>{-3, 2, 5, 8, 11});
+        CHECK(primes == vector<int>{5, 11, 2});
+    }
+
+    SUBCASE("Malformed input") {
+        {
+            ofstream out(path);
+            out << "1 2 3 x4 5\n";
+        }
+        MagicalContainer loaded;
+        CHECK_THROWS_AS(StreamLoader::loadFile(loaded, path), runtime_error);
+        CHECK_THROWS_AS(StreamLoader::loadFile(loaded, "missing_stream.txt"), runtime_error);
+    }
+
+    SUBCASE("addElements bulk insert") {
+        MagicalContainer bulk;
+        bulk.addElement(4);
+        vector<int> values = {9, 1, 7, 4};
+        bulk.addElements(values);
+        vector<int> got;
+        bulk.forEachCross([&](int value) { got.push_back(value); });
+        CHECK(got == vector<int>{1, 9, 4, 7, 4});
+        bulk.removeElement(4);
+        CHECK(bulk.size() == 4);
+    }
+
+    remove(path.c_str());
+}
+
+TEST_CASE("Hot-path statistics") {
+    MagicalContainer container;
+    container.addElement(7);
+    container.addElement(4);
+    container.addElement(9);
+    container.removeElement(4);
+    MagicalContainer::Stats stats = container.stats();
+
+#ifdef MAGICAL_STATS
+    CHECK(stats.addElementCalls == 3);
+    CHECK(stats.removeElementCalls == 1);
+    CHECK(stats.crossRebuilds == 4);
+    CHECK(stats.isPrimeCalls == 4);
+    CHECK(stats.comparisons > 0);
+    CHECK(stats.storageGrowths == 3); // capacity 1, 2, 4
+    container.resetStats();
+    CHECK(container.stats().addElementCalls == 0);
+#else
+    CHECK(stats.addElementCalls == 0);
+    CHECK(stats.isPrimeCalls == 0);
+    CHECK(stats.comparisons == 0);
+#endif
+}
+
+TEST_CASE("Latency histograms") {
+    SUBCASE("Log-linear buckets stay within precision") {
+        for (uint64_t value : {0ULL, 5ULL, 15ULL, 16ULL, 17ULL, 1000ULL, 123456789ULL}) {
+            uint64_t highest = LatencyHistogram::bucketHighest(LatencyHistogram::bucketOf(value));
+            CHECK(highest >= value);
+            CHECK(highest - value <= value / LatencyHistogram::SUB_BUCKETS);
+        }
+        CHECK(LatencyHistogram::bucketOf(UINT64_MAX) == LatencyHistogram::BUCKETS - 1);
+    }
+
+    SUBCASE("Percentiles and merging") {
+        LatencyHistogram first, second;
+        for (uint64_t i = 1; i <= 1000; i++) {
+            first.record(i);
+        }
+        second.record(50000);
+        first.merge(second);
+        CHECK(first.count() == 1001);
+        CHECK(first.max() == 50000);
+        CHECK(first.percentile(0.5) >= 500);
+        CHECK(first.percentile(0.5) <= 532);
+        CHECK(first.percentile(0.99) >= 990);
+        CHECK(first.percentile(1.0) == 50000);
+        first.reset();
+        CHECK(first.percentile(0.5) == 0);
+    }
+
+#ifdef MAGICAL_HISTOGRAMS
+    SUBCASE("Container operations are recorded from every thread") {
+        LatencyRecorder &recorder = LatencyRecorder::instance();
+        recorder.reset();
+        thread worker([] {
+            MagicalContainer container;
+            container.addElement(1);
+        });
+        worker.join();
+        MagicalContainer container;
+        container.addElement(2);
+        container.removeElement(2);
+        MagicalContainer::AscendingIterator it(container);
+        CHECK(it.begin() == it.end());
+        CHECK(recorder.summary(LatencyOp::AddElement).count == 2);
+        CHECK(recorder.summary(LatencyOp::RemoveElement).count == 1);
+        CHECK(recorder.summary(LatencyOp::IteratorConstruction).count == 1);
+        CHECK(recorder.summary(LatencyOp::Begin).count == 1);
+
+        ostringstream text, json;
+        recorder.dumpText(text);
+        recorder.dumpJson(json);
+        CHECK(text.str().find("addElement") != string::npos);
+        CHECK(json.str().find("\"removeElement\": {\"count\": 1") != string::npos);
+    }
+#endif
+}
+
+TEST_CASE("Workload traces") {
+    const string path = "test_trace.bin";
+    {
+        TraceWriter writer(path);
+        MagicalContainer container;
+        container.attachTrace(&writer);
+        container.addElement(5);
+        container.addElement(8);
+        CHECK_THROWS(container.removeElement(100)); // failed operations are not recorded
+        container.removeElement(5);
+        MagicalContainer::PrimeIterator primes(container);
+        CHECK(primes.begin() == primes.end());
+        container.attachTrace(nullptr);
+        container.addElement(1);
+        CHECK(writer.recorded() == 4);
+        writer.flush();
+    }
+
+    vector<TraceEvent> events = TraceReader::readAll(path);
+    REQUIRE(events.size() == 4);
+    CHECK(events[0].op == TraceOp::Add);
+    CHECK(events[0].value == 5);
+    CHECK(events[1].value == 8);
+    CHECK(events[2].op == TraceOp::Remove);
+    CHECK(events[2].value == 5);
+    CHECK(events[3].op == TraceOp::IteratePrime);
+
+    {
+        ofstream out(path, ios::binary | ios::app);
+        out << "xy";
+    }
+    CHECK_THROWS_AS(TraceReader::readAll(path), runtime_error);
+    CHECK_THROWS_AS(TraceReader::readAll("missing_trace.bin"), runtime_error);
+
+    SUBCASE("Versions") {
+        auto writeTrace = [&path](uint32_t version, TraceOp op) {
+            ofstream out(path, ios::binary | ios::trunc);
+            out.write("MGTR", 4);
+            out.write(reinterpret_cast<const char *>(&version), sizeof(version));
+            int32_t value = 0;
+            out.put(static_cast<char>(op));
+            out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        };
+        CHECK(TraceWriter::VERSION == 2);
+        writeTrace(1, TraceOp::IteratePrime);
+        CHECK(TraceReader::readAll(path).size() == 1); // older traces still replay
+        writeTrace(1, TraceOp::IterateDescending);
+        CHECK_THROWS_AS(TraceReader::readAll(path), runtime_error); // not an opcode of version 1
+        writeTrace(2, TraceOp::IterateDescending);
+        CHECK(TraceReader::readAll(path)[0].op == TraceOp::IterateDescending);
+        writeTrace(3, TraceOp::Add);
+        CHECK_THROWS_AS(TraceReader::readAll(path), runtime_error);
+    }
+    remove(path.c_str());
+}
+
+TEST_CASE("Traces follow the container they are attached to") {
+    const string path = "test_copy_trace.bin";
+    const string snapshot = "test_trace_snapshot.bin";
+    {
+        TraceWriter writer(path);
+        MagicalContainer container;
+        container.attachTrace(&writer);
+        container.addElements(vector<int>{4, 6});
+
+        MagicalContainer copy(container);
+        copy.addElement(100);
+        MagicalContainer assigned;
+        assigned = container;
+        assigned.removeElement(4);
+        CHECK(writer.recorded() == 2);
+
+        {
+            ofstream out("test_trace_stream.txt");
+            out << "7 8 9";
+        }
+        StreamLoader::loadFile(container, "test_trace_stream.txt");
+        remove("test_trace_stream.txt");
+        CHECK(writer.recorded() == 5);
+
+        copy.save(snapshot);
+        CHECK_THROWS_AS(container.load(snapshot), logic_error);
+        CHECK(container.size() == 5);
+        container.attachTrace(nullptr);
+        container.load(snapshot);
+        CHECK(container.size() == 3);
+        remove(snapshot.c_str());
+    }
+    vector<TraceEvent> events = TraceReader::readAll(path);
+    REQUIRE(events.size() == 5);
+    CHECK(events[1].value == 6);
+    CHECK(events[4].value == 9);
+    remove(path.c_str());
+}
+
+TEST_CASE("Reverse traversal is traced once") {
+    const string path = "test_reverse_trace.bin";
+    {
+        MagicalContainer container;
+        for (int i = 0; i < 100; i++) {
+            container.addElement(i);
+        }
+        TraceWriter writer(path);
+        container.attachTrace(&writer);
+        MagicalContainer::AscendingIterator ascending(container);
+        MagicalContainer::PrimeIterator primes(container);
+        int visited = 0;
+        for (auto it = ascending.rbegin(); it != ascending.rend(); ++it) {
+            visited++;
+        }
+        for (auto it = primes.rbegin(); it != primes.rend(); ++it) {
+            visited++;
+        }
+        CHECK(visited == 125);
+        CHECK(writer.recorded() == 2);
+        container.attachTrace(nullptr);
+    }
+    vector<TraceEvent> events = TraceReader::readAll(path);
+    REQUIRE(events.size() == 2);
+    CHECK(events[0].op == TraceOp::IterateAscending);
+    CHECK(events[1].op == TraceOp::IteratePrime);
+    remove(path.c_str());
+}
+
+TEST_CASE("Workload generator") {
+    WorkloadSpec spec;
+    spec.initialSize = 100;
+    spec.operations = 2000;
+    spec.valueRange = 1000;
+
+    SUBCASE("Removes only target live values") {
+        WorkloadGenerator generator(spec);
+        MagicalContainer container;
+        vector<int32_t> initial = generator.initialValues();
+        container.addElements(initial);
+        size_t adds = 0, removes = 0, scans = 0;
+        TraceEvent event{};
+        while (generator.next(event)) {
+            if (event.op == TraceOp::Add) {
+                container.addElement(event.value);
+                ++adds;
+            } else if (event.op == TraceOp::Remove) {
+                CHECK_NOTHROW(container.removeElement(event.value));
+                ++removes;
+            } else {
+                ++scans;
+            }
+        }
+        CHECK(adds + removes + scans == 2000);
+        CHECK(adds > removes);
+        CHECK(removes > scans);
+        CHECK(container.size() == 100 + adds - removes);
+    }
+
+    SUBCASE("Sorted distributions") {
+        spec.distribution = Distribution::Presorted;
+        vector<int32_t> values = WorkloadGenerator(spec).initialValues();
+        CHECK(is_sorted(values.begin(), values.end()));
+        spec.distribution = Distribution::ReverseSorted;
+        values = WorkloadGenerator(spec).initialValues();
+        CHECK(is_sorted(values.rbegin(), values.rend()));
+        CHECK(values.front() == 999);
+    }
+
+    SUBCASE("Skewed distributions") {
+        spec.distribution = Distribution::DuplicateHeavy;
+        spec.duplicatePool = 8;
+        for (int32_t value : WorkloadGenerator(spec).initialValues()) {
+            CHECK(value < 8);
+        }
+
+        spec.distribution = Distribution::PrimeHeavy;
+        spec.primeShare = 1;
+        MagicalContainer container;
+        container.addElements(WorkloadGenerator(spec).initialValues());
+        MagicalContainer::PrimeIterator primes(container);
+        CHECK(primes.size() == 100);
+
+        spec.valueRange = 14; // the walk past 13 wraps to 2, still inside [0, 14)
+        for (int32_t value : WorkloadGenerator(spec).initialValues()) {
+            CHECK((value >= 2 && value < 14));
+        }
+        spec.valueRange = 2; // no prime in [0, 2)
+        CHECK_THROWS_AS(WorkloadGenerator{spec}, invalid_argument);
+        spec.valueRange = 1 << 30;
+
+        spec.distribution = Distribution::Zipfian;
+        vector<int32_t> values = WorkloadGenerator(spec).initialValues();
+        CHECK(count(values.begin(), values.end(), 0) > 5); // rank 0 is the most frequent value
+        spec.zipfSkew = 1;
+        CHECK_THROWS_AS(WorkloadGenerator{spec}, invalid_argument);
+    }
+
+    SUBCASE("Sharded backend and trace output") {
+        spec.seed = 7;
+        WorkloadGenerator generator(spec);
+        ShardedMagicalContainer sharded;
+        vector<int32_t> initial = generator.initialValues();
+        sharded.addElements(initial);
+        CHECK(sharded.size() == 100);
+
+        const string path = "test_workload.bin";
+        WorkloadGenerator(spec).writeTrace(path);
+        vector<TraceEvent> events = TraceReader::readAll(path);
+        REQUIRE(events.size() == 2100);
+        CHECK(events[0].op == TraceOp::Add);
+        CHECK(events[0].value == initial[0]);
+        remove(path.c_str());
+    }
+
+    spec.valueRange = 0;
+    CHECK_THROWS_AS(WorkloadGenerator{spec}, invalid_argument);
+}
+
+// Asymptotic bounds on operation counts instead of wall-clock time; the counters only exist in
+// MAGICAL_STATS builds (make complexity).
+TEST_CASE("Complexity bounds") {
+#ifdef MAGICAL_STATS
+    const size_t n = 4096;
+    const double logN = 12;
+    vector<int> values = WorkloadGenerator(WorkloadSpec{.initialSize = n}).initialValues();
+
+    SUBCASE("Inserting n elements costs O(n log n) comparisons") {
+        MagicalContainer container;
+        for (int value : values) {
+            container.addElement(value);
+        }
+        MagicalContainer::Stats stats = container.stats();
+        CHECK(stats.comparisons <= static_cast<uint64_t>(static_cast<double>(n) * (logN + 1)));
+        CHECK(stats.isPrimeCalls == n);
+        CHECK(stats.storageGrowths <= static_cast<uint64_t>(logN) + 1);
+    }
+
+    SUBCASE("Bulk insert costs O(n log n) comparisons") {
+        MagicalContainer container;
+        container.addElements(values);
+        container.addElements(values);
+        CHECK(container.stats().comparisons <= static_cast<uint64_t>(4 * static_cast<double>(n) * (logN + 2)));
+        CHECK(container.stats().isPrimeCalls == 2 * n);
+    }
+
+    SUBCASE("A single remove costs O(log n) comparisons") {
+        MagicalContainer container;
+        container.addElements(values);
+        for (size_t i = 0; i < 16; i++) {
+            container.resetStats();
+            container.removeElement(values[i * 97]);
+            MagicalContainer::Stats stats = container.stats();
+            CHECK(stats.comparisons <= static_cast<uint64_t>(logN) + 2);
+            CHECK(stats.isPrimeCalls == 1);
+            CHECK(stats.storageGrowths == 0);
+        }
+        container.resetStats();
+        CHECK_THROWS(container.removeElement(-1));
+        CHECK(container.stats().comparisons <= static_cast<uint64_t>(logN) + 2);
+    }
+
+    SUBCASE("Duplicates cost one comparison each") {
+        MagicalContainer container;
+        for (int i = 0; i < 100; i++) {
+            container.addElement(i % 2 == 0 ? 7 : i);
+        }
+        container.resetStats();
+        container.removeElement(7);
+        CHECK(container.stats().comparisons <= 8 + 50);
+    }
+
+    SUBCASE("Membership queries") {
+        MagicalContainer container;
+        container.addElements(values);
+        container.resetStats();
+        CHECK(container.contains(values[5]));
+        container.count(values[5]);
+        CHECK(container.stats().comparisons <= 3 * (static_cast<uint64_t>(logN) + 2));
+
+        container.resetStats();
+        container.containsMany(values); // linear merge, the query sort is not counted
+        CHECK(container.stats().comparisons <= n);
+    }
+#else
+    CHECK(MagicalContainer().stats().comparisons == 0);
+#endif
+}
+
+TEST_CASE("Incremental views") {
+    MagicalContainer container;
+    vector<int> values = {5, 3, 8, 3, 11, 5, 2, 9, 3};
+    for (int value : values) {
+        container.addElement(value);
+    }
+    container.removeElement(3);
+    container.removeElement(8);
+    container.addElement(4);
+    container.removeElement(11);
+
+    vector<int> ascending, primes, cross;
+    MagicalContainer::AscendingIterator asc(container);
+    for (auto it = asc.begin(); it != asc.end(); ++it) {
+        ascending.push_back(*it);
+    }
+    CHECK(ascending == vector<int>{2, 3, 3, 4, 5, 5, 9});
+    MagicalContainer::PrimeIterator prime(container);
+    for (auto it = prime.begin(); it != prime.end(); ++it) {
+        primes.push_back(*it);
+    }
+    CHECK(primes == vector<int>{5, 3, 5, 2, 3});
+    MagicalContainer::SideCrossIterator side(container);
+    for (auto it = side.begin(); it != side.end(); ++it) {
+        cross.push_back(*it);
+    }
+    CHECK(cross == vector<int>{2, 9, 3, 5, 3, 5, 4});
+
+    MagicalContainer copy(container);
+    container.removeElement(9);
+    copy.addElement(1);
+    MagicalContainer::AscendingIterator copyAsc(copy);
+    CHECK(*copyAsc.begin() == 1);
+    CHECK(copyAsc.size() == 8);
+    copy = container;
+    MagicalContainer::SideCrossIterator copySide(copy);
+    CHECK(*++copySide.begin() == 5);
+}
+
+TEST_CASE("Allocation-free iteration") {
+    MagicalContainer container;
+    container.addElements(vector<int>{17, 2, 25, 9, 3, 4, 11, 8});
+    long long sum = 0;
+
+    // first use of per-thread state (latency histograms) may allocate once
+    MagicalContainer::AscendingIterator warmup(container);
+    sum += *warmup.begin() + *warmup.end().begin();
+
+    SUBCASE("Constructing, copying, comparing and advancing") {
+        uint64_t allocations = allocationsDuring([&] {
+            MagicalContainer::AscendingIterator asc(container);
+            MagicalContainer::SideCrossIterator cross(container);
+            MagicalContainer::PrimeIterator prime(container);
+            MagicalContainer::AscendingIterator ascCopy(asc);
+            MagicalContainer::SideCrossIterator crossCopy(cross);
+            MagicalContainer::PrimeIterator primeCopy(prime);
+            ascCopy = asc.begin();
+            crossCopy = cross.begin();
+            primeCopy = prime.begin();
+            ++ascCopy;
+            ++crossCopy;
+            ++primeCopy;
+            sum += *ascCopy + *crossCopy + *primeCopy;
+            sum += (ascCopy == asc.end()) + (crossCopy != cross.end()) + (primeCopy < prime.end()) + (ascCopy > asc.begin());
+            sum += asc[3] + cross[3] + prime[1];
+        });
+        CHECK(allocations == 0);
+    }
+
+    SUBCASE("Full traversals") {
+        uint64_t allocations = allocationsDuring([&] {
+            MagicalContainer::AscendingIterator asc(container);
+            for (auto it = asc.begin(); it != asc.end(); ++it) {
+                sum += *it;
+            }
+            MagicalContainer::SideCrossIterator cross(container);
+            for (auto it = cross.begin(); it != cross.end(); ++it) {
+                sum += *it;
+            }
+            MagicalContainer::PrimeIterator prime(container);
+            for (int value : prime) {
+                sum += value;
+            }
+            container.forEachAscending([&](int value) { sum += value; });
+            int block[4];
+            for (MagicalContainer::AscendingIterator batches(container); batches.nextBatch(block) > 0;) {
+                sum += block[0];
+            }
+        });
+        CHECK(allocations == 0);
+    }
+
+    SUBCASE("addElement allocates amortized O(1) times") {
+        MagicalContainer grown;
+        const size_t n = 10000;
+        uint64_t allocations = allocationsDuring([&] {
+            for (size_t i = 0; i < n; i++) {
+                grown.addElement(static_cast<int>((i * 7919) % n));
+            }
+        });
+        CHECK(allocations <= 6 * 15); // a few buffers growing geometrically, about log2(n) times each
+        CHECK(allocations > 0);
+    }
+
+    CHECK(sum != 0);
+}
+
+TEST_CASE("Sentinel loop termination") {
+    MagicalContainer container;
+    container.addElements(vector<int>{17, 2, 25, 9, 3});
+
+    vector<int> ascending, cross, primes;
+    MagicalContainer::AscendingIterator asc(container);
+    for (auto it = asc.begin(); it != default_sentinel; ++it) {
+        ascending.push_back(*it);
+    }
+    CHECK(ascending == vector<int>{2, 3, 9, 17, 25});
+    MagicalContainer::SideCrossIterator side(container);
+    for (auto it = side.begin(); it != default_sentinel; ++it) {
+        cross.push_back(*it);
+    }
+    CHECK(cross == vector<int>{2, 25, 3, 17, 9});
+    MagicalContainer::PrimeIterator prime(container);
+    for (auto it = prime.begin(); default_sentinel != it; ++it) {
+        primes.push_back(*it);
+    }
+    CHECK(primes == vector<int>{17, 2, 3});
+
+    CHECK(asc.end() == default_sentinel);
+    CHECK_FALSE(asc.begin() == default_sentinel);
+    CHECK(asc.atPosition(5) == default_sentinel);
+
+    // the sentinel follows the live view size
+    auto it = asc.begin();
+    for (int i = 0; i < 4; i++) {
+        ++it;
+    }
+    CHECK(it != default_sentinel);
+    container.removeElement(2);
+    CHECK(it == default_sentinel);
+
+    MagicalContainer empty;
+    MagicalContainer::PrimeIterator none(empty);
+    CHECK(none.begin() == default_sentinel);
+}
+
+TEST_CASE("Compact iterators") {
+    static_assert(sizeof(MagicalContainer::AscendingIterator) <= 2 * sizeof(void *));
+    static_assert(is_trivially_copy_constructible_v<MagicalContainer::SideCrossIterator>);
+    static_assert(is_trivially_destructible_v<MagicalContainer::PrimeIterator>);
+    static_assert(is_trivially_copyable_v<MagicalContainer::AscendingIterator> == !MAGICAL_CHECKED_ITERATORS);
+
+    MagicalContainer container;
+    container.addElements(vector<int>{10, 20, 30});
+    MagicalContainer::AscendingIterator asc(container);
+    auto it = asc.begin();
+    ++it;
+
+    // positions stay meaningful when the views reallocate
+    for (int i = 0; i < 1000; i++) {
+        container.addElement(1000 + i);
+    }
+    CHECK(*it == 20);
+    CHECK(it.position() == 1);
+
+    // copies are plain memory copies of {container, position}
+    MagicalContainer::AscendingIterator copies[2] = {asc.begin(), asc.begin()};
+    memcpy(static_cast<void *>(&copies[1]), static_cast<const void *>(&it), sizeof(it));
+    CHECK(*copies[1] == 20);
+    CHECK(copies[0] < copies[1]);
+}
+
+TEST_CASE("Descending and reverse traversal") {
+    MagicalContainer container;
+    container.addElements(vector<int>{17, 2, 25, 9, 3});
+
+    SUBCASE("DescendingIterator") {
+        MagicalContainer::DescendingIterator desc(container);
+        vector<int> values;
+        for (auto it = desc.begin(); it != desc.end(); ++it) {
+            values.push_back(*it);
+        }
+        CHECK(values == vector<int>{25, 17, 9, 3, 2});
+        CHECK(desc[0] == 25);
+        CHECK(desc.size() == 5);
+
+        // top-k largest without touching the rest of the view
+        vector<int> top(2);
+        CHECK(desc.begin().nextBatch(top) == 2);
+        CHECK(top == vector<int>{25, 17});
+
+        auto it = desc.end();
+        --it;
+        CHECK(*it == 2);
+        CHECK_THROWS_AS(--desc.begin(), runtime_error);
+        CHECK_THROWS_AS(*desc.end(), runtime_error);
+        CHECK(desc.atPosition(5) == default_sentinel);
+
+        vector<int> splitValues;
+        for (const auto &range : desc.split(3)) {
+            for (auto cur = range.begin(); cur != range.end(); ++cur) {
+                splitValues.push_back(*cur);
+            }
+        }
+        CHECK(splitValues == values);
+    }
+
+    SUBCASE("rbegin and rend on every view") {
+        vector<int> ascending, cross, primes, descending;
+        MagicalContainer::AscendingIterator asc(container);
+        for (auto it = asc.rbegin(); it != asc.rend(); ++it) {
+            ascending.push_back(*it);
+        }
+        CHECK(ascending == vector<int>{25, 17, 9, 3, 2});
+        MagicalContainer::SideCrossIterator side(container);
+        for (auto it = side.rbegin(); it != side.rend(); ++it) {
+            cross.push_back(*it);
+        }
+        CHECK(cross == vector<int>{9, 17, 3, 25, 2});
+        MagicalContainer::PrimeIterator prime(container);
+        for (auto it = prime.rbegin(); it != prime.rend(); ++it) {
+            primes.push_back(*it);
+        }
+        CHECK(primes == vector<int>{3, 2, 17});
+        MagicalContainer::DescendingIterator desc(container);
+        for (auto it = desc.rbegin(); it != desc.rend(); ++it) {
+            descending.push_back(*it);
+        }
+        CHECK(descending == vector<int>{2, 3, 9, 17, 25});
+
+        auto it = asc.begin();
+        ++it;
+        --it;
+        CHECK(*it == 2);
+        CHECK_THROWS_AS(--it, runtime_error);
+    }
+
+    SUBCASE("Empty container") {
+        MagicalContainer empty;
+        MagicalContainer::DescendingIterator desc(empty);
+        CHECK(desc.begin() == desc.end());
+        MagicalContainer::PrimeIterator prime(empty);
+        CHECK(prime.rbegin() == prime.rend());
+    }
+}
+
+TEST_CASE("Seeking AscendingIterator by value") {
+    MagicalContainer container;
+    container.addElements(vector<int>{17, 2, 25, 9, 3, 9, 40});
+    MagicalContainer::AscendingIterator asc(container);
+
+    SUBCASE("Range scans") {
+        vector<int> values;
+        for (auto it = asc.lowerBound(3), last = asc.upperBound(17); it != last; ++it) {
+            values.push_back(*it);
+        }
+        CHECK(values == vector<int>{3, 9, 9, 17});
+
+        values.clear();
+        for (auto it = asc.lowerBound(10), last = asc.upperBound(16); it != last; ++it) {
+            values.push_back(*it);
+        }
+        CHECK(values.empty());
+    }
+
+    SUBCASE("Bounds") {
+        CHECK(*asc.lowerBound(9) == 9);
+        CHECK(asc.lowerBound(9).position() == 2);
+        CHECK(asc.upperBound(9).position() == 4);
+        CHECK(*asc.lowerBound(-5) == 2);
+        CHECK(asc.lowerBound(41) == asc.end());
+        CHECK(asc.upperBound(40) == default_sentinel);
+        CHECK_THROWS_AS(*asc.upperBound(40), runtime_error);
+    }
+
+    SUBCASE("seek moves in place") {
+        auto it = asc.begin();
+        it.seek(18);
+        CHECK(*it == 25);
+        ++it;
+        CHECK(*it == 40);
+        CHECK(*it.seek(0) == 2);
+    }
+
+#ifdef MAGICAL_STATS
+    SUBCASE("O(log n) comparisons") {
+        MagicalContainer large;
+        vector<int> values(4096);
+        for (size_t i = 0; i < values.size(); i++) {
+            values[i] = static_cast<int>(i * 3);
+        }
+        large.addElements(values);
+        large.resetStats();
+        MagicalContainer::AscendingIterator it(large);
+        CHECK(*it.lowerBound(3001) == 3003);
+        CHECK(large.stats().comparisons <= 13);
+    }
+#endif
+}
+
+TEST_CASE("Rank and select") {
+    MagicalContainer container;
+    container.addElements(vector<int>{50, 10, 40, 20, 30, 20});
+
+    CHECK(container.nth(0) == 10);
+    CHECK(container.nth(2) == 20);
+    CHECK(container.nth(5) == 50);
+    CHECK_THROWS_AS(container.nth(6), out_of_range);
+
+    CHECK(container.rank(10) == 0);
+    CHECK(container.rank(20) == 1);
+    CHECK(container.rank(25) == 3);
+    CHECK(container.rank(1000) == 6);
+    CHECK(container.rank(-1) == 0);
+    for (size_t k = 0; k < container.size(); k++) {
+        CHECK(container.rank(container.nth(k)) <= k);
+    }
+
+    CHECK(container.quantile(0) == 10);
+    CHECK(container.quantile(0.5) == 20);
+    CHECK(container.quantile(0.51) == 30);
+    CHECK(container.quantile(1) == 50);
+    CHECK_THROWS_AS(container.quantile(1.5), invalid_argument);
+    CHECK_THROWS_AS(container.quantile(-0.1), invalid_argument);
+
+    container.removeElement(10);
+    CHECK(container.nth(0) == 20);
+    CHECK(container.rank(30) == 2);
+
+    MagicalContainer empty;
+    CHECK_THROWS_AS(empty.quantile(0.5), out_of_range);
+    CHECK(empty.rank(3) == 0);
+}
+
+TEST_CASE("Eytzinger search index") {
+    MagicalContainer plain;
+    MagicalContainer indexed;
+    indexed.setSearchIndex(true);
+    CHECK(indexed.hasSearchIndex());
+    CHECK_FALSE(plain.hasSearchIndex());
+    CHECK(indexed.rank(7) == 0);
+
+    vector<int> values;
+    for (int i = 0; i < 1000; i++) {
+        values.push_back((i * 7919) % 500 - 250); // duplicates and negatives
+    }
+    plain.addElements(values);
+    indexed.addElements(values);
+
+    MagicalContainer::AscendingIterator plainAsc(plain);
+    MagicalContainer::AscendingIterator indexedAsc(indexed);
+    for (int value = -260; value <= 260; value++) {
+        CHECK(indexed.rank(value) == plain.rank(value));
+        CHECK(indexedAsc.lowerBound(value).position() == plainAsc.lowerBound(value).position());
+    }
+
+    SUBCASE("Rebuilt after mutations") {
+        indexed.addElement(1000);
+        indexed.removeElement(-250);
+        indexed.removeElement(-250);
+        CHECK(indexed.rank(-250) == 0);
+        CHECK(indexed.rank(-249) == 0);
+        CHECK(indexed.rank(1000) == indexed.size() - 1);
+        CHECK(*indexedAsc.seek(300) == 1000);
+    }
+
+    SUBCASE("Copies keep the setting") {
+        MagicalContainer copy(indexed);
+        CHECK(copy.hasSearchIndex());
+        copy.addElement(-1000);
+        CHECK(copy.rank(-250) == 1);
+        CHECK(indexed.rank(-250) == 0);
+    }
+
+    SUBCASE("Concurrent queries after a mutation") {
+        indexed.addElement(777); // the index is rebuilt here, not by the readers below
+        vector<thread> readers;
+        atomic<size_t> mismatches(0);
+        for (int t = 0; t < 4; t++) {
+            readers.emplace_back([&] {
+                for (int value = -260; value <= 260; value++) {
+                    if (indexed.rank(value) != plain.rank(value) || !indexed.contains(777))
+                        mismatches++;
+                }
+            });
+        }
+        for (thread &reader : readers) {
+            reader.join();
+        }
+        CHECK(mismatches == 0);
+    }
+
+    SUBCASE("Disabling falls back to binary search") {
+        indexed.setSearchIndex(false);
+        CHECK(indexed.rank(0) == plain.rank(0));
+    }
+}
+
+TEST_CASE("Membership queries") {
+    MagicalContainer container;
+    container.addElements(vector<int>{8, 3, 8, -4, 15, 8, numeric_limits<int>::max(), numeric_limits<int>::min()});
+
+    SUBCASE("contains and count") {
+        CHECK(container.contains(8));
+        CHECK(container.contains(-4));
+        CHECK_FALSE(container.contains(4));
+        CHECK_FALSE(container.contains(16));
+        CHECK(container.count(8) == 3);
+        CHECK(container.count(3) == 1);
+        CHECK(container.count(9) == 0);
+        CHECK(container.count(numeric_limits<int>::max()) == 1);
+        CHECK(container.count(numeric_limits<int>::min()) == 1);
+
+        container.removeElement(8);
+        CHECK(container.count(8) == 2);
+        container.setSearchIndex(true);
+        CHECK(container.count(8) == 2);
+        CHECK(container.contains(15));
+        CHECK_FALSE(container.contains(14));
+        CHECK(container.count(numeric_limits<int>::max()) == 1);
+    }
+
+    SUBCASE("containsMany keeps query order") {
+        vector<int> queries{15, 4, 8, -4, 8, 100, numeric_limits<int>::min(), 3};
+        CHECK(container.containsMany(queries) == vector<bool>{true, false, true, true, true, false, true, true});
+        CHECK(container.containsMany(vector<int>{}).empty());
+        CHECK(MagicalContainer().containsMany(queries) == vector<bool>(queries.size(), false));
+    }
+
+    SUBCASE("Agrees with contains") {
+        vector<int> queries;
+        for (int value = -20; value <= 20; value++) {
+            queries.push_back(value);
+        }
+        vector<bool> found = container.containsMany(queries);
+        for (size_t i = 0; i < queries.size(); i++) {
+            CHECK(found[i] == container.contains(queries[i]));
+        }
+    }
+}
+
+TEST_CASE("Cached aggregates") {
+    MagicalContainer container;
+    CHECK(container.sum() == 0);
+    CHECK(container.primeCount() == 0);
+    CHECK_THROWS_AS(container.min(), out_of_range);
+    CHECK_THROWS_AS(container.max(), out_of_range);
+
+    container.addElement(10);
+    container.addElements(vector<int>{7, -3, 2, 25});
+    CHECK(container.sum() == 41);
+    CHECK(container.min() == -3);
+    CHECK(container.max() == 25);
+    CHECK(container.primeCount() == 2);
+
+    container.removeElement(-3);
+    container.removeElement(25);
+    CHECK(container.sum() == 19);
+    CHECK(container.min() == 2);
+    CHECK(container.max() == 10);
+    CHECK_THROWS(container.removeElement(100));
+    CHECK(container.sum() == 19);
+
+    SUBCASE("No overflow at int limits") {
+        container.addElements(vector<int>{numeric_limits<int>::max(), numeric_limits<int>::max()});
+        CHECK(container.sum() == 19 + 2 * static_cast<int64_t>(numeric_limits<int>::max()));
+    }
+
+    SUBCASE("Copies and snapshots") {
+        MagicalContainer copy(container);
+        copy.addElement(1);
+        CHECK(copy.sum() == 20);
+        CHECK(container.sum() == 19);
+        container = copy;
+        CHECK(container.sum() == 20);
+
+        const string path = "aggregates_snapshot.bin";
+        container.save(path);
+        MagicalContainer loaded;
+        loaded.load(path);
+        remove(path.c_str());
+        CHECK(loaded.sum() == 20);
+        CHECK(loaded.primeCount() == 2);
+    }
+
+    SUBCASE("Sharded") {
+        ShardedMagicalContainer sharded(4);
+        CHECK_THROWS_AS(sharded.max(), out_of_range);
+        sharded.addElements(vector<int>{5, -8, 13, 40, 9});
+        sharded.removeElement(40);
+        CHECK(sharded.sum() == 19);
+        CHECK(sharded.min() == -8);
+        CHECK(sharded.max() == 13);
+        CHECK(sharded.primeCount() == 2);
+    }
+}
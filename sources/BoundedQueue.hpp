@@ -0,0 +1,73 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <optional>
+
+namespace ariel
+{
+
+    // Blocking single-lock FIFO with a fixed capacity, used between pipeline stages.
+    // push() waits while the queue is full, pop() waits while it is empty and returns
+    // nothing once the queue was closed and drained.
+    template <typename T>
+    class BoundedQueue
+    {
+        std::deque<T> items;
+        size_t capacity;
+        bool closed;
+        std::mutex lock;
+        std::condition_variable notFull;
+        std::condition_variable notEmpty;
+
+    public:
+        explicit BoundedQueue(size_t capacity) : capacity(capacity > 0 ? capacity : 1), closed(false) {}
+
+        // Returns false when the queue was closed before the item could be queued
+        bool push(T item)
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            notFull.wait(guard, [this]
+                         { return closed || items.size() < capacity; });
+            if (closed)
+                return false;
+            items.push_back(std::move(item));
+            notEmpty.notify_one();
+            return true;
+        }
+
+        std::optional<T> pop()
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            notEmpty.wait(guard, [this]
+                          { return closed || !items.empty(); });
+            if (items.empty())
+                return std::nullopt;
+            T item = std::move(items.front());
+            items.pop_front();
+            notFull.notify_one();
+            return item;
+        }
+
+        // Non-blocking pop, used to coalesce whatever is already waiting
+        std::optional<T> tryPop()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (items.empty())
+                return std::nullopt;
+            T item = std::move(items.front());
+            items.pop_front();
+            notFull.notify_one();
+            return item;
+        }
+
+        void close()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            closed = true;
+            notFull.notify_all();
+            notEmpty.notify_all();
+        }
+    };
+} // namespace ariel
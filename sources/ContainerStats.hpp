@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+
+namespace ariel
+{
+
+    // Snapshot of the hot-path counters of one MagicalContainer.
+    // Only collected when compiled with -DMAGICAL_STATS (make STATS=1); otherwise every field stays 0
+    // and the instrumentation compiles to nothing.
+    struct ContainerStats
+    {
+        uint64_t addElementCalls;
+        uint64_t removeElementCalls;
+        uint64_t crossRebuilds;
+        uint64_t isPrimeCalls;   // StreamLoader classifies on its own thread and is not counted here
+        uint64_t comparisons;    // element value comparisons
+        uint64_t elementMoves;   // elements and view pointers written or shifted
+        uint64_t storageGrowths; // reallocations of the element storage
+
+        uint64_t addElementNs;
+        uint64_t removeElementNs;
+        uint64_t crossRebuildNs;
+    };
+
+#ifdef MAGICAL_STATS
+    // Adds the lifetime of the scope in nanoseconds to a counter
+    class ScopedStatsTimer
+    {
+        uint64_t &total;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        explicit ScopedStatsTimer(uint64_t &total) : total(total), start(std::chrono::steady_clock::now()) {}
+        ~ScopedStatsTimer()
+        {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            total += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+        ScopedStatsTimer(const ScopedStatsTimer &other) = delete;
+        ScopedStatsTimer &operator=(const ScopedStatsTimer &other) = delete;
+        ScopedStatsTimer(ScopedStatsTimer &&other) = delete;
+        ScopedStatsTimer &operator=(ScopedStatsTimer &&other) = delete;
+    };
+
+#define MAGICAL_STATS_COUNT(stats, field) (++(stats).field)
+#define MAGICAL_STATS_ADD(stats, field, amount) ((stats).field += static_cast<uint64_t>(amount))
+#define MAGICAL_STATS_TIME(stats, field) ScopedStatsTimer magicalStatsTimer_##field((stats).field)
+#else
+#define MAGICAL_STATS_COUNT(stats, field) ((void)0)
+#define MAGICAL_STATS_ADD(stats, field, amount) ((void)0)
+#define MAGICAL_STATS_TIME(stats, field) ((void)0)
+#endif
+} // namespace ariel
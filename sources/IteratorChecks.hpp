@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cassert>
+
+// Iterator misuse checks: dereferencing or advancing past end(), and comparing or assigning
+// iterators of different containers.
+//
+//   MAGICAL_CHECKED_ITERATORS 1  the checks throw (default, what the tests expect)
+//   MAGICAL_CHECKED_ITERATORS 0  the checks become assert()s, so -DNDEBUG removes them entirely
+//
+// The mode changes the iterator classes (unchecked iterators get a defaulted, trivial operator=),
+// so like MAGICAL_STATS it is a library-wide setting: the library and every translation unit using
+// it must agree. It is therefore selected only by -DMAGICAL_UNCHECKED (make UNCHECKED=1), never by
+// NDEBUG, which differs between translation units far too easily.
+#ifndef MAGICAL_CHECKED_ITERATORS
+#if defined(MAGICAL_UNCHECKED)
+#define MAGICAL_CHECKED_ITERATORS 0
+#else
+#define MAGICAL_CHECKED_ITERATORS 1
+#endif
+#endif
+
+#if MAGICAL_CHECKED_ITERATORS
+#define MAGICAL_ITERATOR_CHECK(condition, Exception, message) \
+    do                                                        \
+    {                                                         \
+        if (!(condition))                                     \
+            throw Exception(message);                         \
+    } while (false)
+#else
+#define MAGICAL_ITERATOR_CHECK(condition, Exception, message) assert((condition) && (message))
+#endif
@@ -0,0 +1,200 @@
+#include "LatencyHistogram.hpp"
+#include <bit>
+#include <iomanip>
+#include <algorithm>
+
+using namespace ariel;
+using namespace std;
+
+/*------------------------------------------
+--------------LatencyHistogram--------------
+--------------------------------------------*/
+
+size_t LatencyHistogram::bucketOf(uint64_t ns)
+{
+    if (ns < SUB_BUCKETS)
+        return static_cast<size_t>(ns); // exact below the first power of two that gets split
+
+    auto exponent = static_cast<unsigned>(std::bit_width(ns) - 1);
+    if (exponent > MAX_EXPONENT)
+        return BUCKETS - 1;
+    uint64_t sub = (ns >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return static_cast<size_t>((exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub);
+}
+
+uint64_t LatencyHistogram::bucketHighest(size_t bucket)
+{
+    if (bucket < SUB_BUCKETS)
+        return bucket;
+
+    uint64_t exponent = bucket / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    uint64_t sub = bucket % SUB_BUCKETS;
+    uint64_t width = uint64_t(1) << (exponent - SUB_BUCKET_BITS);
+    return (uint64_t(1) << exponent) + (sub + 1) * width - 1;
+}
+
+void LatencyHistogram::record(uint64_t ns)
+{
+    buckets[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    uint64_t seen = maximum.load(std::memory_order_relaxed);
+    while (ns > seen && !maximum.compare_exchange_weak(seen, ns, std::memory_order_relaxed))
+    {
+    }
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other)
+{
+    for (size_t i = 0; i < BUCKETS; i++)
+    {
+        buckets[i].fetch_add(other.buckets[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    total.fetch_add(other.total.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    uint64_t otherMax = other.maximum.load(std::memory_order_relaxed);
+    if (otherMax > maximum.load(std::memory_order_relaxed))
+        maximum.store(otherMax, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto &bucket : buckets)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    total.store(0, std::memory_order_relaxed);
+    maximum.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::count() const
+{
+    return total.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::max() const
+{
+    return maximum.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::percentile(double q) const
+{
+    uint64_t recorded = count();
+    if (recorded == 0)
+        return 0;
+
+    auto rank = static_cast<uint64_t>(q * static_cast<double>(recorded) + 0.5);
+    rank = rank == 0 ? 1 : (rank > recorded ? recorded : rank);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++)
+    {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+            return std::min(bucketHighest(i), max()); // never report more than was recorded
+    }
+    return max();
+}
+
+/*------------------------------------------
+-------------------------------------------*/
+
+/*------------------------------------------
+--------------LatencyRecorder---------------
+--------------------------------------------*/
+
+LatencyRecorder &LatencyRecorder::instance()
+{
+    static LatencyRecorder recorder;
+    return recorder;
+}
+
+LatencyRecorder::HistogramSet &LatencyRecorder::local()
+{
+    thread_local HistogramSet *set = nullptr;
+    if (set == nullptr)
+    {
+        std::lock_guard<std::mutex> guard(registryLock);
+        perThread.push_back(std::make_unique<HistogramSet>()); // outlives the thread so reads still see it
+        set = perThread.back().get();
+    }
+    return *set;
+}
+
+void LatencyRecorder::record(LatencyOp op, uint64_t ns)
+{
+    local()[static_cast<size_t>(op)].record(ns);
+}
+
+void LatencyRecorder::mergeInto(LatencyOp op, LatencyHistogram &out)
+{
+    std::lock_guard<std::mutex> guard(registryLock);
+    for (const auto &set : perThread)
+    {
+        out.merge((*set)[static_cast<size_t>(op)]);
+    }
+}
+
+LatencySummary LatencyRecorder::summary(LatencyOp op)
+{
+    LatencyHistogram histogram;
+    mergeInto(op, histogram);
+    return {histogram.count(), histogram.percentile(0.5), histogram.percentile(0.99), histogram.percentile(0.999), histogram.max()};
+}
+
+void LatencyRecorder::reset()
+{
+    std::lock_guard<std::mutex> guard(registryLock);
+    for (const auto &set : perThread)
+    {
+        for (auto &histogram : *set)
+        {
+            histogram.reset();
+        }
+    }
+}
+
+const char *LatencyRecorder::name(LatencyOp op)
+{
+    switch (op)
+    {
+    case LatencyOp::AddElement:
+        return "addElement";
+    case LatencyOp::RemoveElement:
+        return "removeElement";
+    case LatencyOp::IteratorConstruction:
+        return "iteratorConstruction";
+    case LatencyOp::Begin:
+        return "begin";
+    case LatencyOp::End:
+        return "end";
+    default:
+        return "unknown";
+    }
+}
+
+void LatencyRecorder::dumpText(std::ostream &out)
+{
+    out << std::left << std::setw(22) << "operation" << std::right << std::setw(12) << "count" << std::setw(12) << "p50 ns"
+        << std::setw(12) << "p99 ns" << std::setw(12) << "p99.9 ns" << std::setw(12) << "max ns" << '\n';
+    for (size_t i = 0; i < static_cast<size_t>(LatencyOp::Count); i++)
+    {
+        auto op = static_cast<LatencyOp>(i);
+        LatencySummary stats = summary(op);
+        out << std::left << std::setw(22) << name(op) << std::right << std::setw(12) << stats.count << std::setw(12) << stats.p50
+            << std::setw(12) << stats.p99 << std::setw(12) << stats.p999 << std::setw(12) << stats.max << '\n';
+    }
+}
+
+void LatencyRecorder::dumpJson(std::ostream &out)
+{
+    out << "{";
+    for (size_t i = 0; i < static_cast<size_t>(LatencyOp::Count); i++)
+    {
+        auto op = static_cast<LatencyOp>(i);
+        LatencySummary stats = summary(op);
+        out << (i == 0 ? "" : ", ") << "\"" << name(op) << "\": {\"count\": " << stats.count << ", \"p50_ns\": " << stats.p50
+            << ", \"p99_ns\": " << stats.p99 << ", \"p999_ns\": " << stats.p999 << ", \"max_ns\": " << stats.max << "}";
+    }
+    out << "}\n";
+}
+
+/*------------------------------------------
+-------------------------------------------*/
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace ariel
+{
+
+    // Log-linear latency histogram in the style of HdrHistogram: every power of two is split into
+    // SUB_BUCKETS linear buckets, so any recorded value is off by at most 1/SUB_BUCKETS (~6%).
+    // Buckets are relaxed atomics, so one thread may record while another merges.
+    class LatencyHistogram
+    {
+    public:
+        static constexpr unsigned SUB_BUCKET_BITS = 4;
+        static constexpr uint64_t SUB_BUCKETS = 1U << SUB_BUCKET_BITS;
+        static constexpr unsigned MAX_EXPONENT = 40; // ~18 minutes in ns, larger values share the top bucket
+        static constexpr size_t BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+        void record(uint64_t ns);
+        void merge(const LatencyHistogram &other);
+        void reset();
+
+        uint64_t count() const;
+        uint64_t max() const;
+        uint64_t percentile(double q) const; // q in [0, 1], highest value of the bucket holding it
+
+        static size_t bucketOf(uint64_t ns);
+        static uint64_t bucketHighest(size_t bucket);
+
+    private:
+        std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+        std::atomic<uint64_t> total{0};
+        std::atomic<uint64_t> maximum{0};
+    };
+
+    enum class LatencyOp
+    {
+        AddElement,
+        RemoveElement,
+        IteratorConstruction,
+        Begin,
+        End,
+        Count // number of operations, not an operation
+    };
+
+    struct LatencySummary
+    {
+        uint64_t count;
+        uint64_t p50;
+        uint64_t p99;
+        uint64_t p999;
+        uint64_t max;
+    };
+
+    // Process-wide per-operation histograms. Every thread records into its own set of histograms
+    // without taking a lock; reading merges the sets of all threads that ever recorded.
+    class LatencyRecorder
+    {
+        using HistogramSet = std::array<LatencyHistogram, static_cast<size_t>(LatencyOp::Count)>;
+
+        std::mutex registryLock; // guards perThread, taken once per thread and on reads
+        std::vector<std::unique_ptr<HistogramSet>> perThread;
+
+        LatencyRecorder() = default; // one per process, the per-thread sets are thread_local
+        HistogramSet &local();
+
+    public:
+        static LatencyRecorder &instance();
+
+        void record(LatencyOp op, uint64_t ns);
+        void mergeInto(LatencyOp op, LatencyHistogram &out); // adds every thread's histogram of op into out
+        LatencySummary summary(LatencyOp op);
+        void reset();
+
+        void dumpText(std::ostream &out);
+        void dumpJson(std::ostream &out);
+
+        static const char *name(LatencyOp op);
+    };
+
+#ifdef MAGICAL_HISTOGRAMS
+    // Records the lifetime of the scope into the calling thread's histogram of op
+    class ScopedLatency
+    {
+        LatencyOp op;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        explicit ScopedLatency(LatencyOp op) : op(op), start(std::chrono::steady_clock::now()) {}
+        ~ScopedLatency()
+        {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            LatencyRecorder::instance().record(op, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+        ScopedLatency(const ScopedLatency &other) = delete;
+        ScopedLatency &operator=(const ScopedLatency &other) = delete;
+        ScopedLatency(ScopedLatency &&other) = delete;
+        ScopedLatency &operator=(ScopedLatency &&other) = delete;
+    };
+
+#define MAGICAL_LATENCY(op) ScopedLatency magicalLatency(LatencyOp::op)
+#else
+#define MAGICAL_LATENCY(op) ((void)0)
+#endif
+} // namespace ariel
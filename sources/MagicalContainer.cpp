@@ -1,17 +1,38 @@
 #include "MagicalContainer.hpp"
+#include "SnapshotFormat.hpp"
+#include "WorkloadTrace.hpp"
+#include "IteratorChecks.hpp"
+#ifndef MAGICAL_INLINE_ITERATORS
+#include "MagicalContainerHotPath.hpp" // out-of-line build of the iterator hot path
+#endif
 #include <math.h>
 #include <iostream>
+#include <fstream>
+#include <cstdio>
 #include <algorithm>
+#include <bit>
+#include <limits>
 
 using namespace ariel;
 using namespace std;
 
+namespace
+{
+    const size_t SEARCH_PREFETCH_STRIDE = 16; // 16 ints, one 64 byte cache line of great-great-grandchildren
+}
+
 /*------------------------------------------
 ----------------MagicalContainer------------
 --------------------------------------------*/
 
 // Private methods
 bool MagicalContainer::isPrime(int num) const
+{
+    MAGICAL_STATS_COUNT(statistics, isPrimeCalls);
+    return isPrimeNumber(num);
+}
+
+bool MagicalContainer::isPrimeNumber(int num)
 {
     if (num <= 1)
         return false;
@@ -25,6 +46,11 @@ bool MagicalContainer::isPrime(int num) const
 
 void MagicalContainer::updateCrossElements()
 {
+    MAGICAL_STATS_COUNT(statistics, crossRebuilds);
+    MAGICAL_STATS_TIME(statistics, crossRebuildNs);
+    MAGICAL_STATS_ADD(statistics, elementMoves, sortedElements.size());
+    if (useSearchIndex) // every mutation ends here
+        buildSearchIndex();
     crossElements.clear();                  // clear existing elements in list
     auto start_it = sortedElements.begin(); // iterator to first element
     auto end_it = sortedElements.rbegin();  // iterator to last element (reversed)
@@ -46,71 +72,341 @@ void MagicalContainer::updateCrossElements()
         add_from_start = !add_from_start; // switch between adding from start and end
     }
 }
-void MagicalContainer::updateSortedElements()
+
+bool MagicalContainer::lessByValue(const int *a, const int *b) const
 {
-    sortedElements.clear(); // Clear existing elements in the list
+    MAGICAL_STATS_COUNT(statistics, comparisons);
+    return *a < *b;
+}
 
-    for (auto it = originalElements.begin(); it != originalElements.end(); ++it)
+size_t MagicalContainer::lowerBoundIndex(int value) const
+{
+    auto position = std::lower_bound(sortedElements.begin(), sortedElements.end(), value, [this](const int *a, int target)
+                                     {
+                                         MAGICAL_STATS_COUNT(statistics, comparisons);
+                                         return *a < target; });
+    return static_cast<size_t>(position - sortedElements.begin());
+}
+
+size_t MagicalContainer::upperBoundIndex(int value) const
+{
+    auto position = std::upper_bound(sortedElements.begin(), sortedElements.end(), value, [this](int target, const int *a)
+                                     {
+                                         MAGICAL_STATS_COUNT(statistics, comparisons);
+                                         return target < *a; });
+    return static_cast<size_t>(position - sortedElements.begin());
+}
+
+size_t MagicalContainer::searchLowerBound(int value) const
+{
+    if (!useSearchIndex || searchIndex.empty()) // empty only in a moved-from container
+        return lowerBoundIndex(value);
+
+    // descend the implicit tree: node k has children 2k and 2k + 1
+    const int *index = searchIndex.data();
+    size_t n = searchIndex.size() - 1;
+    size_t k = 1;
+    while (k <= n)
     {
-        sortedElements.push_back(&(*it)); // Store the address of each element
+        MAGICAL_STATS_COUNT(statistics, comparisons);
+#if defined(__GNUC__)
+        if (SEARCH_PREFETCH_STRIDE * k <= n)
+            __builtin_prefetch(index + SEARCH_PREFETCH_STRIDE * k); // the node's descendants four levels down
+#endif
+        k = 2 * k + (index[k] < value ? 1 : 0);
     }
+    // the answer is the last node where the search went left: strip the trailing right turns and that left turn
+    k >>= std::countr_one(k) + 1;
+    return k == 0 ? sortedElements.size() : searchRanks[k];
+}
 
-    std::sort(sortedElements.begin(), sortedElements.end(), [](int *a, int *b)
-              {
-                  return *a < *b; // Sort the pointers based on the pointed values
-              });
+// In-order walk of the implicit tree, so node values come out in sorted order
+size_t MagicalContainer::fillSearchIndex(size_t node, size_t next)
+{
+    if (node >= searchIndex.size())
+        return next;
+    next = fillSearchIndex(2 * node, next);
+    searchIndex[node] = *sortedElements[next];
+    searchRanks[node] = static_cast<uint32_t>(next);
+    return fillSearchIndex(2 * node + 1, next + 1);
 }
 
-void MagicalContainer::updatePrimeElements()
+void MagicalContainer::buildSearchIndex()
 {
-    primeElements.clear(); // Clear existing elements in the list
+    searchIndex.assign(sortedElements.size() + 1, 0);
+    searchRanks.assign(sortedElements.size() + 1, 0);
+    fillSearchIndex(1, 0);
+    MAGICAL_STATS_ADD(statistics, elementMoves, sortedElements.size());
+}
+
+// Grows the element storage to at least capacity. Growing moves the elements, so the views are
+// carried over as indexes into the new buffer.
+void MagicalContainer::reserveElements(size_t capacity)
+{
+    if (capacity <= originalElements.capacity())
+        return;
+
+    const int *oldBase = originalElements.data();
+    std::vector<size_t> sortedIndexes(sortedElements.size());
+    std::vector<size_t> primeIndexes(primeElements.size());
+    for (size_t i = 0; i < sortedElements.size(); i++)
+    {
+        sortedIndexes[i] = static_cast<size_t>(sortedElements[i] - oldBase);
+    }
+    for (size_t i = 0; i < primeElements.size(); i++)
+    {
+        primeIndexes[i] = static_cast<size_t>(primeElements[i] - oldBase);
+    }
 
-    for (auto it = originalElements.begin(); it != originalElements.end(); ++it)
+    originalElements.reserve(capacity);
+    MAGICAL_STATS_COUNT(statistics, storageGrowths);
+    MAGICAL_STATS_ADD(statistics, elementMoves, originalElements.size() + sortedIndexes.size() + primeIndexes.size());
+
+    int *base = originalElements.data();
+    for (size_t i = 0; i < sortedIndexes.size(); i++)
+    {
+        sortedElements[i] = base + sortedIndexes[i];
+    }
+    for (size_t i = 0; i < primeIndexes.size(); i++)
     {
-        if (isPrime(*it))
+        primeElements[i] = base + primeIndexes[i];
+    }
+    for (size_t i = 0; i < crossElements.size(); i++)
+    {
+        crossElements[i] = sortedElements[i % 2 == 0 ? i / 2 : sortedElements.size() - 1 - i / 2];
+    }
+}
+
+// Points the views at this container's own storage, using the layout of other's views
+void MagicalContainer::copyViews(const MagicalContainer &other)
+{
+    const int *otherBase = other.originalElements.data();
+    int *base = originalElements.data();
+    auto rebase = [otherBase, base](const std::vector<int *> &from, std::vector<int *> &to)
+    {
+        to.resize(from.size());
+        for (size_t i = 0; i < from.size(); i++)
+        {
+            to[i] = base + (from[i] - otherBase);
+        }
+    };
+    rebase(other.sortedElements, sortedElements);
+    rebase(other.primeElements, primeElements);
+    rebase(other.crossElements, crossElements);
+}
+
+// Appends a batch whose prime flags were already computed. The new elements are sorted on their
+// own and merged into the sorted view instead of re-sorting everything.
+void MagicalContainer::appendElements(std::span<const int> elements, std::span<const uint8_t> primeFlags)
+{
+    if (elements.empty())
+        return;
+    if (elements.size() > MAX_ELEMENTS - originalElements.size())
+        throw std::length_error("MagicalContainer is full");
+
+    size_t oldSize = originalElements.size();
+    if (oldSize + elements.size() > originalElements.capacity())
+        reserveElements(std::max(oldSize + elements.size(), 2 * originalElements.capacity()));
+    originalElements.insert(originalElements.end(), elements.begin(), elements.end());
+    for (int element : elements)
+    {
+        elementSum += element;
+    }
+    int *base = originalElements.data();
+
+    for (size_t i = oldSize; i < originalElements.size(); i++)
+    {
+        sortedElements.push_back(base + i);
+    }
+    auto byValue = [this](const int *a, const int *b)
+    { return lessByValue(a, b); };
+    auto middle = sortedElements.begin() + static_cast<ptrdiff_t>(oldSize);
+    std::sort(middle, sortedElements.end(), byValue);
+    std::inplace_merge(sortedElements.begin(), middle, sortedElements.end(), byValue);
+    MAGICAL_STATS_ADD(statistics, elementMoves, sortedElements.size());
+
+    for (size_t i = 0; i < elements.size(); i++)
+    {
+        if (primeFlags[i])
+        {
+            primeElements.push_back(base + oldSize + i);
+        }
+    }
+
+    updateCrossElements();
+
+    if (trace != nullptr) // covers addElements and StreamLoader
+    {
+        for (int element : elements)
         {
-            primeElements.push_back(&(*it));
+            trace->record(TraceOp::Add, element);
         }
     }
 }
 
+void MagicalContainer::validateSnapshot(uint64_t checksum, std::span<const int> elements, std::span<const uint32_t> sorted,
+                                        std::span<const uint32_t> primes, bool verifyPrimes)
+{
+    if (snapshotChecksum(elements, sorted, primes) != checksum)
+        throw std::runtime_error("Snapshot checksum does not match");
+
+    size_t count = elements.size();
+    auto outOfRange = [count](uint32_t index)
+    { return index >= count; };
+    if (sorted.size() != count || std::any_of(sorted.begin(), sorted.end(), outOfRange) || std::any_of(primes.begin(), primes.end(), outOfRange))
+        throw std::runtime_error("Snapshot file holds an index out of range");
+
+    std::vector<bool> seen(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (seen[sorted[i]])
+            throw std::runtime_error("Snapshot sorted view is not a permutation");
+        seen[sorted[i]] = true;
+        if (i > 0 && elements[sorted[i]] < elements[sorted[i - 1]])
+            throw std::runtime_error("Snapshot sorted view is not in ascending order");
+    }
+    if (std::adjacent_find(primes.begin(), primes.end(), std::greater_equal<uint32_t>()) != primes.end())
+        throw std::runtime_error("Snapshot prime view is not in insertion order");
+
+    if (!verifyPrimes)
+        return;
+    // primes must be exactly the indexes of the prime elements
+    size_t next = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!isPrimeNumber(elements[i]))
+            continue;
+        if (next == primes.size() || primes[next] != i)
+            throw std::runtime_error("Snapshot prime view does not match the elements");
+        next++;
+    }
+    if (next != primes.size())
+        throw std::runtime_error("Snapshot prime view does not match the elements");
+}
+
 // Public methods
 
+MagicalContainer::MagicalContainer(const MagicalContainer &other)
+    : originalElements(other.originalElements),
+      elementSum(other.elementSum),
+      useSearchIndex(other.useSearchIndex),
+      searchIndex(other.searchIndex), // values and sorted positions, valid in the copy as they are
+      searchRanks(other.searchRanks),
+#ifdef MAGICAL_STATS
+      statistics(other.statistics),
+#endif
+      trace(nullptr) // the trace stays with the original, the copy is a different container
+{
+    copyViews(other);
+}
+
+MagicalContainer &MagicalContainer::operator=(const MagicalContainer &other)
+{
+    if (this != &other)
+    {
+        originalElements = other.originalElements;
+        copyViews(other);
+        elementSum = other.elementSum;
+        useSearchIndex = other.useSearchIndex;
+        searchIndex = other.searchIndex;
+        searchRanks = other.searchRanks;
+#ifdef MAGICAL_STATS
+        statistics = other.statistics;
+#endif
+        // keeps its own trace: other's operations were recorded (or not) by other's trace
+    }
+    return *this;
+}
+
+// Binary searches the insertion point, so an insert costs O(log n) comparisons and a single
+// primality test. Shifting the sorted view and rebuilding the cross view stay linear moves.
 void MagicalContainer::addElement(int element)
 {
-    originalElements.push_back(element); // add element to sortedElements
-    updatePrimeElements();
-    updateSortedElements(); // update sortedElements
-    updateCrossElements();  // update crossElements
+    MAGICAL_LATENCY(AddElement);
+    MAGICAL_STATS_COUNT(statistics, addElementCalls);
+    MAGICAL_STATS_TIME(statistics, addElementNs);
+    if (originalElements.size() >= MAX_ELEMENTS)
+        throw std::length_error("MagicalContainer is full");
+    bool prime = isPrime(element);
+
+    if (originalElements.size() == originalElements.capacity())
+        reserveElements(std::max<size_t>(1, 2 * originalElements.capacity()));
+    originalElements.push_back(element); // no reallocation, the views stay valid
+    int *added = &originalElements.back();
+    elementSum += element;
+
+    // after any equal values, so equal values keep their insertion order
+    auto position = std::upper_bound(sortedElements.begin(), sortedElements.end(), added, [this](const int *a, const int *b)
+                                     { return lessByValue(a, b); });
+    MAGICAL_STATS_ADD(statistics, elementMoves, sortedElements.end() - position);
+    sortedElements.insert(position, added);
+
+    if (prime)
+        primeElements.push_back(added); // newest element, keeps the prime view in insertion order
+    updateCrossElements();
+
+    if (trace != nullptr)
+        trace->record(TraceOp::Add, element);
+}
+
+void MagicalContainer::addElements(std::span<const int> elements)
+{
+    std::vector<uint8_t> primeFlags(elements.size());
+    for (size_t i = 0; i < elements.size(); i++)
+    {
+        primeFlags[i] = isPrime(elements[i]) ? 1 : 0;
+    }
+    appendElements(elements, primeFlags);
 }
 
+// Locates the element through the sorted view with O(log n) comparisons (plus one per duplicate),
+// removes the earliest inserted copy and shifts the pointers that followed it in storage.
 void MagicalContainer::removeElement(int element)
 {
-    // find the iterator for the element to be removed
-    auto it = std::find(originalElements.begin(), originalElements.end(), element);
+    MAGICAL_LATENCY(RemoveElement);
+    MAGICAL_STATS_COUNT(statistics, removeElementCalls);
+    MAGICAL_STATS_TIME(statistics, removeElementNs);
+    auto first = sortedElements.begin() + static_cast<ptrdiff_t>(lowerBoundIndex(element));
 
-    if (it == originalElements.end()) // if element is not in originalElements
+    if (first == sortedElements.end() || **first != element) // if element is not in the container
     {
         throw std::runtime_error("Element not found in container");
-        return;
     }
 
-    // Get the address of the element to be removed
-    int *p = &(*it);
-
-    // Remove the element from originalElements
-    originalElements.erase(it);
-
-    // Remove the pointer from sortedElements
-    sortedElements.erase(std::find(sortedElements.begin(), sortedElements.end(), p));
+    // equal values sit next to each other in the sorted view, remove the one stored first
+    auto victim = first;
+    for (auto it = first + 1; it != sortedElements.end() && **it == element; ++it)
+    {
+        MAGICAL_STATS_COUNT(statistics, comparisons);
+        if (*it < *victim)
+            victim = it;
+    }
+    int *p = *victim;
 
     if (isPrime(element))
-    { // if element is prime, remove from primeElementss
-        primeElements.erase(std::find(primeElements.begin(), primeElements.end(), p));
+    { // the prime view is in storage order, so it can be searched by address
+        primeElements.erase(std::lower_bound(primeElements.begin(), primeElements.end(), p));
     }
-    updatePrimeElements();
-    updateCrossElements(); // update crossElements
-    updateSortedElements();
+    sortedElements.erase(victim);
+    originalElements.erase(originalElements.begin() + (p - originalElements.data()));
+    elementSum -= element;
+
+    // every element stored after the removed one moved down one slot
+    auto shift = [p](std::vector<int *> &view)
+    {
+        for (int *&element : view)
+        {
+            if (element > p)
+                --element;
+        }
+    };
+    shift(sortedElements);
+    shift(primeElements);
+    MAGICAL_STATS_ADD(statistics, elementMoves, originalElements.size() + sortedElements.size() + primeElements.size());
+    updateCrossElements(); // update crossElements, derived from sortedElements
+
+    if (trace != nullptr)
+        trace->record(TraceOp::Remove, element);
 }
 
 size_t MagicalContainer::size() const
@@ -118,6 +414,231 @@ size_t MagicalContainer::size() const
     return originalElements.size(); // return size of originalElements
 }
 
+int64_t MagicalContainer::sum() const
+{
+    return elementSum;
+}
+
+int MagicalContainer::min() const
+{
+    if (sortedElements.empty())
+        throw std::out_of_range("Minimum of an empty container");
+    return *sortedElements.front();
+}
+
+int MagicalContainer::max() const
+{
+    if (sortedElements.empty())
+        throw std::out_of_range("Maximum of an empty container");
+    return *sortedElements.back();
+}
+
+size_t MagicalContainer::primeCount() const
+{
+    return primeElements.size();
+}
+
+bool MagicalContainer::contains(int value) const
+{
+    size_t index = searchLowerBound(value);
+    return index < sortedElements.size() && *sortedElements[index] == value;
+}
+
+size_t MagicalContainer::count(int value) const
+{
+    size_t first = searchLowerBound(value);
+    // int values: the elements greater than value start at the lower bound of value + 1
+    size_t last = value == std::numeric_limits<int>::max() ? sortedElements.size() : searchLowerBound(value + 1);
+    return last - first;
+}
+
+std::vector<bool> MagicalContainer::containsMany(std::span<const int> values) const
+{
+    std::vector<size_t> order(values.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [values](size_t a, size_t b)
+              { return values[a] < values[b]; });
+
+    std::vector<bool> found(values.size());
+    size_t next = 0; // sorted view cursor, only moves forward
+    for (size_t query : order)
+    {
+        int value = values[query];
+        while (next < sortedElements.size() && *sortedElements[next] < value)
+        {
+            MAGICAL_STATS_COUNT(statistics, comparisons);
+            ++next;
+        }
+        found[query] = next < sortedElements.size() && *sortedElements[next] == value;
+    }
+    return found;
+}
+
+int MagicalContainer::nth(size_t k) const
+{
+    if (k >= sortedElements.size())
+        throw std::out_of_range("nth index is out of range");
+    return *sortedElements[k];
+}
+
+size_t MagicalContainer::rank(int value) const
+{
+    return searchLowerBound(value);
+}
+
+int MagicalContainer::quantile(double q) const
+{
+    if (!(q >= 0 && q <= 1)) // also rejects NaN
+        throw std::invalid_argument("Quantile must be in [0, 1]");
+    if (sortedElements.empty())
+        throw std::out_of_range("Quantile of an empty container");
+
+    // smallest value with at least q * n elements at or below it
+    auto n = static_cast<double>(sortedElements.size());
+    auto index = static_cast<size_t>(std::max(std::ceil(q * n) - 1, 0.0));
+    return *sortedElements[std::min(index, sortedElements.size() - 1)];
+}
+
+void MagicalContainer::setSearchIndex(bool enabled)
+{
+    if (enabled == useSearchIndex)
+        return;
+    useSearchIndex = enabled;
+    if (enabled)
+    {
+        buildSearchIndex();
+    }
+    else
+    { // release the memory
+        std::vector<int>().swap(searchIndex);
+        std::vector<uint32_t>().swap(searchRanks);
+    }
+}
+
+bool MagicalContainer::hasSearchIndex() const
+{
+    return useSearchIndex;
+}
+
+void MagicalContainer::save(const std::string &path) const
+{
+    static_assert(sizeof(int) == sizeof(int32_t), "snapshot stores elements as 32 bit integers");
+
+    if (originalElements.size() > UINT32_MAX)
+        throw std::runtime_error("Container is too large for a snapshot");
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.elementCount = originalElements.size();
+    header.primeCount = primeElements.size();
+
+    // views hold pointers, store them as indexes into originalElements
+    const int *base = originalElements.data();
+    std::vector<uint32_t> sorted(sortedElements.size());
+    std::vector<uint32_t> primes(primeElements.size());
+    for (size_t i = 0; i < sortedElements.size(); i++)
+    {
+        sorted[i] = static_cast<uint32_t>(sortedElements[i] - base);
+    }
+    for (size_t i = 0; i < primeElements.size(); i++)
+    {
+        primes[i] = static_cast<uint32_t>(primeElements[i] - base);
+    }
+    header.checksum = snapshotChecksum(originalElements, sorted, primes);
+
+    // written next to the target and renamed over it, so a MappedMagicalContainer that has the old
+    // file mapped keeps reading the old inode instead of faulting on a truncated one
+    const std::string temporary = path + ".tmp";
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!out)
+        throw std::runtime_error("Cant open snapshot file for writing");
+
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(originalElements.data()), static_cast<std::streamsize>(originalElements.size() * sizeof(int)));
+    out.write(reinterpret_cast<const char *>(sorted.data()), static_cast<std::streamsize>(sorted.size() * sizeof(uint32_t)));
+    out.write(reinterpret_cast<const char *>(primes.data()), static_cast<std::streamsize>(primes.size() * sizeof(uint32_t)));
+    out.close();
+    if (!out || std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Failed writing snapshot file");
+    }
+}
+
+void MagicalContainer::load(const std::string &path, bool verifyPrimes)
+{
+    if (trace != nullptr) // a trace has no operation that replaces the contents
+        throw std::logic_error("Cant load a snapshot while a trace is attached");
+
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in)
+        throw std::runtime_error("Cant open snapshot file");
+
+    auto fileSize = static_cast<uint64_t>(in.tellg());
+    in.seekg(0);
+
+    SnapshotHeader header{};
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) || !isSnapshotHeader(header) || snapshotSize(header) != fileSize)
+        throw std::runtime_error("Not a valid snapshot file");
+
+    auto count = static_cast<size_t>(header.elementCount);
+    std::vector<int> elements(count);
+    std::vector<uint32_t> sorted(count);
+    std::vector<uint32_t> primes(static_cast<size_t>(header.primeCount));
+
+    in.read(reinterpret_cast<char *>(elements.data()), static_cast<std::streamsize>(elements.size() * sizeof(int)));
+    in.read(reinterpret_cast<char *>(sorted.data()), static_cast<std::streamsize>(sorted.size() * sizeof(uint32_t)));
+    in.read(reinterpret_cast<char *>(primes.data()), static_cast<std::streamsize>(primes.size() * sizeof(uint32_t)));
+    if (!in)
+        throw std::runtime_error("Failed reading snapshot file");
+
+    validateSnapshot(header.checksum, elements, sorted, primes, verifyPrimes);
+
+    // everything was read and checked, only now replace the contents
+    originalElements = std::move(elements);
+    elementSum = 0;
+    for (int element : originalElements)
+    {
+        elementSum += element;
+    }
+    sortedElements.resize(sorted.size());
+    for (size_t i = 0; i < sorted.size(); i++)
+    {
+        sortedElements[i] = &originalElements[sorted[i]];
+    }
+    primeElements.resize(primes.size());
+    for (size_t i = 0; i < primes.size(); i++)
+    {
+        primeElements[i] = &originalElements[primes[i]];
+    }
+    updateCrossElements(); // linear, derived from sortedElements
+}
+
+void MagicalContainer::attachTrace(TraceWriter *writer)
+{
+    trace = writer;
+}
+
+MagicalContainer::Stats MagicalContainer::stats() const
+{
+#ifdef MAGICAL_STATS
+    return statistics;
+#else
+    return Stats{};
+#endif
+}
+
+void MagicalContainer::resetStats()
+{
+#ifdef MAGICAL_STATS
+    statistics = Stats{};
+#endif
+}
+
 bool MagicalContainer::operator==(const MagicalContainer &other) const
 {
     return originalElements == other.originalElements; // compare originalElements
@@ -136,40 +657,74 @@ bool MagicalContainer::operator!=(const MagicalContainer &other) const
 --------------------------------------------*/
 
 MagicalContainer::BasicIterator::BasicIterator(MagicalContainer &magicalContainer) : magicalContainer(&magicalContainer), pos(0){};
-MagicalContainer::BasicIterator::BasicIterator(const BasicIterator &other) : magicalContainer(other.magicalContainer), pos(other.pos){};
 
-bool MagicalContainer::BasicIterator::operator==(const BasicIterator &other) const
-{
-    if (this->magicalContainer != other.magicalContainer)
-        throw std::invalid_argument("Cant compare iterators from different MagicalContainers");
+/*------------------------------------------
+-------------------------------------------*/
 
-    return pos == other.pos; // compare position
-}
+/*------------------------------------------
+--------------ViewIterator------------------
+--------------------------------------------*/
 
-bool MagicalContainer::BasicIterator::operator!=(const BasicIterator &other) const
+template <typename Derived>
+Derived MagicalContainer::ViewIterator<Derived>::atPosition(size_t index) const
 {
-    if (this->magicalContainer != other.magicalContainer)
-        throw std::invalid_argument("Cant compare iterators from different MagicalContainers");
-
-    return pos != other.pos; // compare position
+    Derived temp(derived()); // create copy of iterator
+    temp.pos = static_cast<uint32_t>(std::min(index, derived().size())); // clamp position to the view
+    return temp;
 }
 
-bool MagicalContainer::BasicIterator::operator<(const BasicIterator &other) const
+template <typename Derived>
+std::vector<SubRange<Derived>> MagicalContainer::ViewIterator<Derived>::split(size_t parts) const
 {
-    if (this->magicalContainer != other.magicalContainer)
-        throw std::invalid_argument("Cant compare iterators from different MagicalContainers");
+    if (parts == 0)
+        throw std::invalid_argument("Cant split a view into zero parts");
+
+    size_t first = std::min<size_t>(pos, derived().size());
+    size_t length = derived().size() - first;
+    std::vector<SubRange<Derived>> ranges;
+    ranges.reserve(parts);
+    for (size_t i = 0; i < parts; i++)
+    {
+        ranges.emplace_back(atPosition(first + length * i / parts), atPosition(first + length * (i + 1) / parts));
+    }
+    return ranges;
+}
 
-    return pos < other.pos; // compare position
+template <typename Derived>
+size_t MagicalContainer::ViewIterator<Derived>::nextBatch(std::span<int> out)
+{
+    const Derived &view = derived();
+    size_t first = std::min<size_t>(pos, view.size());
+    size_t count = std::min(out.size(), view.size() - first);
+    for (size_t i = 0; i < count; i++)
+    {
+        out[i] = view[first + i]; // one bounds check per batch instead of per element
+    }
+    pos = static_cast<uint32_t>(first + count);
+    return count;
 }
 
-bool MagicalContainer::BasicIterator::operator>(const BasicIterator &other) const
+// rbegin() starts a traversal, so it goes through begin() to be recorded once like it; rend() is a
+// bound only and, unlike begin(), may be called on every loop iteration
+template <typename Derived>
+std::reverse_iterator<Derived> MagicalContainer::ViewIterator<Derived>::rbegin()
 {
-    if (this->magicalContainer != other.magicalContainer)
-        throw std::invalid_argument("Cant compare iterators from different MagicalContainers");
+    Derived first = derived().begin();
+    return std::reverse_iterator<Derived>(first.atPosition(first.size())); // dereferences the element before the end
+}
 
-    return pos > other.pos; // compare position
+template <typename Derived>
+std::reverse_iterator<Derived> MagicalContainer::ViewIterator<Derived>::rend()
+{
+    return std::reverse_iterator<Derived>(atPosition(0));
 }
 
+// Defined here for all four iterators, together with the hot path included above
+template class MagicalContainer::ViewIterator<MagicalContainer::AscendingIterator>;
+template class MagicalContainer::ViewIterator<MagicalContainer::DescendingIterator>;
+template class MagicalContainer::ViewIterator<MagicalContainer::SideCrossIterator>;
+template class MagicalContainer::ViewIterator<MagicalContainer::PrimeIterator>;
+
 /*------------------------------------------
 -------------------------------------------*/
 
@@ -177,55 +732,56 @@ bool MagicalContainer::BasicIterator::operator>(const BasicIterator &other) cons
 --------------AscendingIterator-------------
 --------------------------------------------*/
 
-MagicalContainer::AscendingIterator::AscendingIterator(MagicalContainer &magicalContainer) : BasicIterator(magicalContainer)
+MagicalContainer::AscendingIterator::AscendingIterator(MagicalContainer &magicalContainer) : ViewIterator(magicalContainer)
 {
-    it = magicalContainer.sortedElements.begin(); // set iterator to first element
+    MAGICAL_LATENCY(IteratorConstruction);
 };
 
-MagicalContainer::AscendingIterator::AscendingIterator(const AscendingIterator &other) : BasicIterator(other){};
-
+#if MAGICAL_CHECKED_ITERATORS
 MagicalContainer::AscendingIterator &MagicalContainer::AscendingIterator::operator=(const AscendingIterator &other)
 {
-    if (this->magicalContainer != other.magicalContainer)
-        throw std::runtime_error("Cant copy from another container"); // added only to pass the tests... there is no need for this
+    MAGICAL_ITERATOR_CHECK(this->magicalContainer == other.magicalContainer, std::runtime_error, "Cant copy from another container"); // added only to pass the tests... there is no need for this
     magicalContainer = other.magicalContainer;                        // copy MagicalContainer reference
     pos = other.pos;                                                  // copy position
-    it = other.it;                                                    // copy iterator
     return *this;
 }
+#endif
 
-int MagicalContainer::AscendingIterator::operator*() const
+MagicalContainer::AscendingIterator MagicalContainer::AscendingIterator::lowerBound(int value) const
 {
-    if (it == magicalContainer->sortedElements.end())
-        throw std::runtime_error("Iterator is out of range");
-    return **it; // return value of iterator
+    AscendingIterator temp(*this); // create copy of iterator
+    temp.pos = static_cast<uint32_t>(magicalContainer->searchLowerBound(value));
+    return temp;
 }
 
-MagicalContainer::AscendingIterator &MagicalContainer::AscendingIterator::operator++()
+MagicalContainer::AscendingIterator MagicalContainer::AscendingIterator::upperBound(int value) const
 {
-    if (it == magicalContainer->sortedElements.end())
-    {
-        throw std::runtime_error("Iterator is out of range");
-        return *this;
-    }
-    ++it;  // increment iterator
-    ++pos; // increment position
+    AscendingIterator temp(*this); // create copy of iterator
+    temp.pos = static_cast<uint32_t>(magicalContainer->upperBoundIndex(value));
+    return temp;
+}
+
+MagicalContainer::AscendingIterator &MagicalContainer::AscendingIterator::seek(int value)
+{
+    pos = static_cast<uint32_t>(magicalContainer->searchLowerBound(value));
     return *this;
 }
 
 MagicalContainer::AscendingIterator MagicalContainer::AscendingIterator::begin()
 {
+    MAGICAL_LATENCY(Begin);
+    if (magicalContainer->trace != nullptr)
+        magicalContainer->trace->record(TraceOp::IterateAscending);
     AscendingIterator temp(*this);                      // create copy of iterator
-    temp.it = magicalContainer->sortedElements.begin(); // set iterator to first element
     temp.pos = 0;                                       // set position to 0
     return temp;
 }
 
 MagicalContainer::AscendingIterator MagicalContainer::AscendingIterator::end()
 {
+    MAGICAL_LATENCY(End);
     AscendingIterator temp(*this);                      // create copy of iterator
-    temp.it = magicalContainer->sortedElements.end();   // set iterator to last element
-    temp.pos = magicalContainer->sortedElements.size(); // set position to size of container
+    temp.pos = static_cast<uint32_t>(magicalContainer->sortedElements.size()); // set position to size of container
     return temp;
 }
 
@@ -233,58 +789,79 @@ MagicalContainer::AscendingIterator MagicalContainer::AscendingIterator::end()
 -------------------------------------------*/
 
 /*------------------------------------------
---------------SideCrossIterator------------
+--------------DescendingIterator------------
 --------------------------------------------*/
 
-MagicalContainer::SideCrossIterator::SideCrossIterator(MagicalContainer &magicalContainer) : BasicIterator(magicalContainer)
+MagicalContainer::DescendingIterator::DescendingIterator(MagicalContainer &magicalContainer) : ViewIterator(magicalContainer)
 {
-    it = magicalContainer.crossElements.begin(); // set iterator to first element
+    MAGICAL_LATENCY(IteratorConstruction);
 };
 
-MagicalContainer::SideCrossIterator::SideCrossIterator(const SideCrossIterator &other) : BasicIterator(other){};
-
-MagicalContainer::SideCrossIterator &MagicalContainer::SideCrossIterator::operator=(const SideCrossIterator &other)
+#if MAGICAL_CHECKED_ITERATORS
+MagicalContainer::DescendingIterator &MagicalContainer::DescendingIterator::operator=(const DescendingIterator &other)
 {
-    if (this->magicalContainer != other.magicalContainer)
-        throw std::runtime_error("Cant copy from another container");
+    MAGICAL_ITERATOR_CHECK(this->magicalContainer == other.magicalContainer, std::runtime_error, "Cant copy from another container");
     magicalContainer = other.magicalContainer; // copy MagicalContainer reference
     pos = other.pos;                           // copy position
-    it = other.it;                             // copy iterator
     return *this;
 }
+#endif
 
-int MagicalContainer::SideCrossIterator::operator*() const
+MagicalContainer::DescendingIterator MagicalContainer::DescendingIterator::begin()
 {
-    if (it == magicalContainer->crossElements.end())
-        throw std::runtime_error("Iterator is out of range");
-    return **it; // return value of iterator
+    MAGICAL_LATENCY(Begin);
+    if (magicalContainer->trace != nullptr)
+        magicalContainer->trace->record(TraceOp::IterateDescending);
+    DescendingIterator temp(*this);                      // create copy of iterator
+    temp.pos = 0;                                       // set position to 0
+    return temp;
 }
 
-MagicalContainer::SideCrossIterator &MagicalContainer::SideCrossIterator::operator++()
+MagicalContainer::DescendingIterator MagicalContainer::DescendingIterator::end()
 {
-    if (it == magicalContainer->crossElements.end())
-    {
-        throw std::runtime_error("Iterator is out of range");
-        return *this;
-    }
-    ++it;  // increment iterator
-    ++pos; // increment position
+    MAGICAL_LATENCY(End);
+    DescendingIterator temp(*this);                      // create copy of iterator
+    temp.pos = static_cast<uint32_t>(magicalContainer->sortedElements.size()); // set position to size of container
+    return temp;
+}
+
+/*------------------------------------------
+-------------------------------------------*/
+
+/*------------------------------------------
+--------------SideCrossIterator------------
+--------------------------------------------*/
+
+MagicalContainer::SideCrossIterator::SideCrossIterator(MagicalContainer &magicalContainer) : ViewIterator(magicalContainer)
+{
+    MAGICAL_LATENCY(IteratorConstruction);
+};
+
+#if MAGICAL_CHECKED_ITERATORS
+MagicalContainer::SideCrossIterator &MagicalContainer::SideCrossIterator::operator=(const SideCrossIterator &other)
+{
+    MAGICAL_ITERATOR_CHECK(this->magicalContainer == other.magicalContainer, std::runtime_error, "Cant copy from another container");
+    magicalContainer = other.magicalContainer; // copy MagicalContainer reference
+    pos = other.pos;                           // copy position
     return *this;
 }
+#endif
 
 MagicalContainer::SideCrossIterator MagicalContainer::SideCrossIterator::begin()
 {
+    MAGICAL_LATENCY(Begin);
+    if (magicalContainer->trace != nullptr)
+        magicalContainer->trace->record(TraceOp::IterateCross);
     SideCrossIterator temp(*this);                     // create copy of iterator
-    temp.it = magicalContainer->crossElements.begin(); // set iterator to first element
     temp.pos = 0;                                      // set position to 0
     return temp;
 }
 
 MagicalContainer::SideCrossIterator MagicalContainer::SideCrossIterator::end()
 {
+    MAGICAL_LATENCY(End);
     SideCrossIterator temp(*this);                     // create copy of iterator
-    temp.it = magicalContainer->crossElements.end();   // set iterator to last element
-    temp.pos = magicalContainer->crossElements.size(); // set position to size of container
+    temp.pos = static_cast<uint32_t>(magicalContainer->crossElements.size()); // set position to size of container
     return temp;
 }
 
@@ -295,55 +872,36 @@ MagicalContainer::SideCrossIterator MagicalContainer::SideCrossIterator::end()
 --------------PrimeIterator-----------------
 --------------------------------------------*/
 
-MagicalContainer::PrimeIterator::PrimeIterator(MagicalContainer &magicalContainer) : BasicIterator(magicalContainer)
+MagicalContainer::PrimeIterator::PrimeIterator(MagicalContainer &magicalContainer) : ViewIterator(magicalContainer)
 {
-    it = magicalContainer.primeElements.begin(); // set iterator to first element
+    MAGICAL_LATENCY(IteratorConstruction);
 };
 
-MagicalContainer::PrimeIterator::PrimeIterator(const PrimeIterator &other) : BasicIterator(other){};
-
+#if MAGICAL_CHECKED_ITERATORS
 MagicalContainer::PrimeIterator &MagicalContainer::PrimeIterator::operator=(const PrimeIterator &other)
 {
-    if (this->magicalContainer != other.magicalContainer)
-        throw std::runtime_error("Cant copy from another container");
+    MAGICAL_ITERATOR_CHECK(this->magicalContainer == other.magicalContainer, std::runtime_error, "Cant copy from another container");
     magicalContainer = other.magicalContainer; // copy MagicalContainer reference
     pos = other.pos;                           // copy position
-    it = other.it;                             // copy iterator
-    return *this;
-}
-
-int MagicalContainer::PrimeIterator::operator*() const
-{
-    if (it == magicalContainer->primeElements.end())
-        throw std::runtime_error("Iterator is out of range");
-    return **it; // return value of iterator
-}
-
-MagicalContainer::PrimeIterator &MagicalContainer::PrimeIterator::operator++()
-{
-    if (it == magicalContainer->primeElements.end())
-    {
-        throw std::runtime_error("Iterator is out of range");
-        return *this;
-    }
-    ++it;  // increment iterator
-    ++pos; // increment position
     return *this;
 }
+#endif
 
 MagicalContainer::PrimeIterator MagicalContainer::PrimeIterator::begin()
 {
+    MAGICAL_LATENCY(Begin);
+    if (magicalContainer->trace != nullptr)
+        magicalContainer->trace->record(TraceOp::IteratePrime);
     PrimeIterator temp(*this);                         // create copy of iterator
-    temp.it = magicalContainer->primeElements.begin(); // set iterator to first element
     temp.pos = 0;                                      // set position to 0
     return temp;
 }
 
 MagicalContainer::PrimeIterator MagicalContainer::PrimeIterator::end()
 {
+    MAGICAL_LATENCY(End);
     PrimeIterator temp(*this);                         // create copy of iterator
-    temp.it = magicalContainer->primeElements.end();   // set iterator to last element
-    temp.pos = magicalContainer->primeElements.size(); // set position to size of container
+    temp.pos = static_cast<uint32_t>(magicalContainer->primeElements.size()); // set position to size of container
     return temp;
 }
 
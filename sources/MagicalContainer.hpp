@@ -4,9 +4,20 @@
 #include <iterator>
 #include <set>
 #include <list>
+#include <span>
+#include <string>
+#include <cstdint>
+#include "SubRange.hpp"
+#include "ContainerStats.hpp"
+#include "LatencyHistogram.hpp"
+#include "IteratorChecks.hpp"
 
 namespace ariel
 {
+    class ShardedMagicalContainer;
+    class MappedMagicalContainer;
+    class StreamLoader;
+    class TraceWriter;
 
     class MagicalContainer
     {
@@ -14,45 +25,171 @@ namespace ariel
         std::vector<int *> crossElements;  // stores elements pointers in cross order
         std::vector<int *> sortedElements; // stores elements pointers in ascending order
         std::vector<int *> primeElements;  // stores elements pointers that are prime numbers in original order
+        int64_t elementSum = 0;            // kept up to date by every mutation, cannot overflow below MAX_ELEMENTS
 
-        bool isPrime(int number) const;
+        // Optional copy of the sorted values in Eytzinger (BFS) order, 1 based, with the sorted index of
+        // every node, rebuilt by every mutation so queries never write to it
+        bool useSearchIndex = false;
+        std::vector<int> searchIndex;
+        std::vector<uint32_t> searchRanks;
+
+#ifdef MAGICAL_STATS
+        mutable ContainerStats statistics{};
+#endif
+
+        TraceWriter *trace = nullptr; // not owned, records operations when attached
+
+        static bool isPrimeNumber(int number);
+        bool isPrime(int number) const; // isPrimeNumber, counted in stats
+        bool lessByValue(const int *a, const int *b) const; // counted in stats
+        size_t lowerBoundIndex(int value) const;            // first sorted index whose value is not less than value
+        size_t upperBoundIndex(int value) const;            // first sorted index whose value is greater than value
+        size_t searchLowerBound(int value) const;           // lowerBoundIndex, through the search index when enabled
+        size_t fillSearchIndex(size_t node, size_t next);
+        void buildSearchIndex();
         void updateCrossElements();
-        void updateSortedElements();
-        void updatePrimeElements();
+        void reserveElements(size_t capacity);
+        void copyViews(const MagicalContainer &other);
+        void appendElements(std::span<const int> elements, std::span<const uint8_t> primeFlags);
+        // Throws std::runtime_error unless the sections match checksum, sorted is a permutation of the element
+        // indexes ordered by value and primes are strictly increasing indexes, all in linear time.
+        // verifyPrimes also tests every element for primality, to prove primes lists exactly the prime elements.
+        static void validateSnapshot(uint64_t checksum, std::span<const int> elements, std::span<const uint32_t> sorted,
+                                     std::span<const uint32_t> primes, bool verifyPrimes);
 
         class BasicIterator; // forward declaration of nested class 
+        template <typename Derived>
+        class ViewIterator; // members shared by the four view iterators
+
+        friend class ShardedMagicalContainer; // merges the shards' views directly
+        friend class StreamLoader;            // classifies primes off the inserting thread
+        friend class MappedMagicalContainer;  // validates mapped snapshots like load()
 
     public:
+        static constexpr size_t MAX_ELEMENTS = UINT32_MAX; // iterators hold 32 bit positions
+
         MagicalContainer() = default;
         ~MagicalContainer() = default;
-        MagicalContainer(const MagicalContainer &other) = default;
-        MagicalContainer &operator=(const MagicalContainer &other) = default;
+        MagicalContainer(const MagicalContainer &other); // the copy's views point into its own storage
+        MagicalContainer &operator=(const MagicalContainer &other);
         MagicalContainer(MagicalContainer &&other) noexcept = default;
         MagicalContainer &operator=(MagicalContainer &&other) noexcept = default;
 
         void addElement(int element);
+        // Appends all elements at once: the batch is sorted and merged into the views a single time
+        void addElements(std::span<const int> elements);
         void removeElement(int element);
         size_t size() const;
 
+        // Aggregates for polling, O(1) and without touching the elements: the sum is maintained by every
+        // mutation, min and max are the ends of the sorted view. min() and max() throw std::out_of_range when empty.
+        int64_t sum() const;
+        int min() const;
+        int max() const;
+        size_t primeCount() const;
+
+        // Membership through the sorted view (or the search index when enabled), O(log n)
+        bool contains(int value) const;
+        size_t count(int value) const;
+        // One flag per query, in query order: the queries are sorted and merged against the sorted view in a
+        // single pass, O(q log q + n), for batches too large to binary search one by one
+        std::vector<bool> containsMany(std::span<const int> values) const;
+
+        // Order statistics over the sorted view
+        int nth(size_t k) const;         // k-th smallest value (0 based), O(1), throws std::out_of_range
+        size_t rank(int value) const;    // number of elements smaller than value, O(log n)
+        int quantile(double q) const;    // nearest-rank quantile for q in [0, 1], O(1), throws when empty
+
+        // Serves rank() and AscendingIterator::lowerBound/seek from an Eytzinger layout of the sorted view
+        // with software prefetch instead of a binary search that misses cache on large containers.
+        // Costs 8 bytes per element and an O(n) rebuild in every mutation (which already rebuilds the cross
+        // view in O(n)), so it pays off for read-heavy phases. Queries only read it, so concurrent const
+        // queries are as safe with the index as without it.
+        void setSearchIndex(bool enabled);
+        bool hasSearchIndex() const;
+
+        // Records every added and removed element (including addElements and StreamLoader batches) and every
+        // view traversal (begin() or rbegin() call) to writer, or stops recording when writer is nullptr.
+        // The writer must outlive the attachment. A trace replays from an empty container, so attach it
+        // before the first element; load() throws std::logic_error while a trace is attached.
+        // Copies do not inherit the trace.
+        void attachTrace(TraceWriter *writer);
+
+        using Stats = ContainerStats;
+        Stats stats() const; // all zero unless built with MAGICAL_STATS
+        void resetStats();
+
+        // Binary snapshot (see SnapshotFormat.hpp) holding the elements together with the sorted and
+        // prime views, so load() needs no sorting or primality testing. load() verifies the header checksum and
+        // the structure of the views in linear time, throws on any mismatch and only then replaces the contents;
+        // verifyPrimes additionally re-tests every element for primality (as slow as addElements).
+        // save() writes path + ".tmp" and renames it over path, so readers never see a partial file.
+        void save(const std::string &path) const;
+        void load(const std::string &path, bool verifyPrimes = false);
+
         bool operator==(const MagicalContainer &other) const;
         bool operator!=(const MagicalContainer &other) const;
 
+        // Internal iteration: calls f(value) for every element of a view with no per-element range checks.
+        // f must not add or remove elements.
+        template <typename Function>
+        void forEachAscending(Function f) const;
+        template <typename Function>
+        void forEachCross(Function f) const;
+        template <typename Function>
+        void forEachPrime(Function f) const;
+
         // Nested classes
         class AscendingIterator;
+        class DescendingIterator;
         class SideCrossIterator;
         class PrimeIterator;
     };
 
+    template <typename Function>
+    void MagicalContainer::forEachAscending(Function f) const
+    {
+        for (const int *element : sortedElements)
+        {
+            f(*element);
+        }
+    }
+
+    template <typename Function>
+    void MagicalContainer::forEachCross(Function f) const
+    {
+        for (const int *element : crossElements)
+        {
+            f(*element);
+        }
+    }
+
+    template <typename Function>
+    void MagicalContainer::forEachPrime(Function f) const
+    {
+        for (const int *element : primeElements)
+        {
+            f(*element);
+        }
+    }
+
+    // Iterators are a container pointer and a 32 bit index into the view (16 bytes), so they stay
+    // valid when the view reallocates. Unchecked builds make them trivially copyable.
     class MagicalContainer::BasicIterator
     {
     protected:
         MagicalContainer *magicalContainer;
-        size_t pos;
-        std::vector<int *>::iterator it;
+        uint32_t pos;
 
     public:
+        using iterator_category = std::bidirectional_iterator_tag; // for std::reverse_iterator
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = int; // values are returned by copy
+
         BasicIterator(MagicalContainer &magicalContainer);
-        BasicIterator(const BasicIterator &other);
+        BasicIterator(const BasicIterator &other) = default;
         ~BasicIterator() = default;
         BasicIterator(BasicIterator &&other) noexcept = default;
         BasicIterator &operator=(BasicIterator &&other) noexcept = default;
@@ -62,63 +199,158 @@ namespace ariel
         bool operator!=(const BasicIterator &other) const;
         bool operator>(const BasicIterator &other) const;
         bool operator<(const BasicIterator &other) const;
+
+        size_t position() const; // index into the view this iterator walks
     };
 
-    class MagicalContainer::AscendingIterator : public MagicalContainer::BasicIterator
+    // Members every view iterator shares, written once against the Derived iterator (CRTP).
+    // Derived provides size() and operator[] (random access into the whole view), begin() and end().
+    template <typename Derived>
+    class MagicalContainer::ViewIterator : public MagicalContainer::BasicIterator
+    {
+    public:
+        using BasicIterator::BasicIterator;
+
+        // Loop termination against std::default_sentinel: compares the position with the live view
+        // size, with no end() copy and no container identity check
+        using BasicIterator::operator==;
+        using BasicIterator::operator!=;
+        bool operator==(std::default_sentinel_t) const;
+        bool operator!=(std::default_sentinel_t) const;
+
+        // Copy of this iterator moved to index (clamped to the end of the view)
+        Derived atPosition(size_t index) const;
+        // k balanced sub-ranges covering [position(), size())
+        std::vector<SubRange<Derived>> split(size_t parts) const;
+
+        // Copies up to out.size() values in view order and advances past them, returns how many were copied
+        size_t nextBatch(std::span<int> out);
+
+        // Last to first over the same view, no copy of the elements
+        std::reverse_iterator<Derived> rbegin();
+        std::reverse_iterator<Derived> rend();
+
+    private:
+        Derived &derived() { return static_cast<Derived &>(*this); }
+        const Derived &derived() const { return static_cast<const Derived &>(*this); }
+    };
+
+    class MagicalContainer::AscendingIterator : public MagicalContainer::ViewIterator<MagicalContainer::AscendingIterator>
     {
 
     public:
         AscendingIterator(MagicalContainer &magicalContainer);
-        AscendingIterator(const AscendingIterator &other);
+        AscendingIterator(const AscendingIterator &other) = default;
         ~AscendingIterator() = default;
         AscendingIterator(AscendingIterator &&other) noexcept = default;
         AscendingIterator &operator=(AscendingIterator &&other) noexcept = default;
 
-        AscendingIterator &operator=(const AscendingIterator &other);
+#if MAGICAL_CHECKED_ITERATORS
+        AscendingIterator &operator=(const AscendingIterator &other); // throws for an iterator of another container
+#else
+        AscendingIterator &operator=(const AscendingIterator &other) = default;
+#endif
 
         int operator*() const;
         AscendingIterator &operator++();
+        AscendingIterator &operator--(); // steps back one element, throws at the first one
+
+        size_t size() const;
+        int operator[](size_t index) const; // smallest first
+
+        // Binary search of the sorted view, O(log n): a scan of [a, b] is lowerBound(a) up to upperBound(b)
+        AscendingIterator lowerBound(int value) const; // at the first element >= value, or at the end
+        AscendingIterator upperBound(int value) const; // at the first element > value, or at the end
+        AscendingIterator &seek(int value);            // moves this iterator to lowerBound(value)
 
         AscendingIterator begin();
         AscendingIterator end();
     };
 
-    class MagicalContainer::SideCrossIterator : public MagicalContainer::BasicIterator
+    // Walks the sorted view from the largest element, so the k largest values cost O(k)
+    class MagicalContainer::DescendingIterator : public MagicalContainer::ViewIterator<MagicalContainer::DescendingIterator>
+    {
+
+    public:
+        DescendingIterator(MagicalContainer &magicalContainer);
+        DescendingIterator(const DescendingIterator &other) = default;
+        ~DescendingIterator() = default;
+        DescendingIterator(DescendingIterator &&other) noexcept = default;
+        DescendingIterator &operator=(DescendingIterator &&other) noexcept = default;
+
+#if MAGICAL_CHECKED_ITERATORS
+        DescendingIterator &operator=(const DescendingIterator &other); // throws for an iterator of another container
+#else
+        DescendingIterator &operator=(const DescendingIterator &other) = default;
+#endif
+
+        int operator*() const;
+        DescendingIterator &operator++();
+        DescendingIterator &operator--(); // steps back one element, throws at the first one
+
+        size_t size() const;
+        int operator[](size_t index) const; // largest first
+
+        DescendingIterator begin();
+        DescendingIterator end();
+    };
+
+    class MagicalContainer::SideCrossIterator : public MagicalContainer::ViewIterator<MagicalContainer::SideCrossIterator>
     {
         
 
     public:
         SideCrossIterator(MagicalContainer &magicalContainer);
-        SideCrossIterator(const SideCrossIterator &other);
+        SideCrossIterator(const SideCrossIterator &other) = default;
         ~SideCrossIterator() = default;
         SideCrossIterator(SideCrossIterator &&other) noexcept = default;
         SideCrossIterator &operator=(SideCrossIterator &&other) noexcept = default;
 
-        SideCrossIterator &operator=(const SideCrossIterator &other);
+#if MAGICAL_CHECKED_ITERATORS
+        SideCrossIterator &operator=(const SideCrossIterator &other); // throws for an iterator of another container
+#else
+        SideCrossIterator &operator=(const SideCrossIterator &other) = default;
+#endif
 
         int operator*() const;
         SideCrossIterator &operator++();
+        SideCrossIterator &operator--(); // steps back one element, throws at the first one
+
+        size_t size() const;
+        int operator[](size_t index) const; // in cross order
 
         SideCrossIterator begin();
         SideCrossIterator end();
     };
 
-    class MagicalContainer::PrimeIterator : public MagicalContainer::BasicIterator
+    class MagicalContainer::PrimeIterator : public MagicalContainer::ViewIterator<MagicalContainer::PrimeIterator>
     {
 
     public:
         PrimeIterator(MagicalContainer &magicalContainer);
-        PrimeIterator(const PrimeIterator &other);
+        PrimeIterator(const PrimeIterator &other) = default;
         ~PrimeIterator() = default;
         PrimeIterator(PrimeIterator &&other) noexcept = default;
         PrimeIterator &operator=(PrimeIterator &&other) noexcept = default;
 
-        PrimeIterator &operator=(const PrimeIterator &other);
+#if MAGICAL_CHECKED_ITERATORS
+        PrimeIterator &operator=(const PrimeIterator &other); // throws for an iterator of another container
+#else
+        PrimeIterator &operator=(const PrimeIterator &other) = default;
+#endif
 
         int operator*() const;
         PrimeIterator &operator++();
+        PrimeIterator &operator--(); // steps back one element, throws at the first one
+
+        size_t size() const;
+        int operator[](size_t index) const; // prime elements in insertion order
 
         PrimeIterator begin();
         PrimeIterator end();
     };
-} // namespace ariel
\ No newline at end of file
+} // namespace ariel
+
+#ifdef MAGICAL_INLINE_ITERATORS
+#include "MagicalContainerHotPath.hpp"
+#endif
@@ -0,0 +1,208 @@
+#pragma once
+
+// Iterator hot path: dereference, increment, comparisons and random access.
+// Compiled into MagicalContainer.cpp by default. With -DMAGICAL_INLINE_ITERATORS (make INLINE=1)
+// MagicalContainer.hpp includes this file instead and every function here becomes inline, so
+// loops over the iterators can be inlined and vectorized without LTO.
+
+#include "MagicalContainer.hpp"
+#include "IteratorChecks.hpp"
+#include <stdexcept>
+
+#ifdef MAGICAL_INLINE_ITERATORS
+#define MAGICAL_HOT_PATH inline
+#else
+#define MAGICAL_HOT_PATH
+#endif
+
+namespace ariel
+{
+    /*------------------------------------------
+    --------------BasicIterator-------------
+    --------------------------------------------*/
+
+    MAGICAL_HOT_PATH bool MagicalContainer::BasicIterator::operator==(const BasicIterator &other) const
+    {
+        MAGICAL_ITERATOR_CHECK(this->magicalContainer == other.magicalContainer, std::invalid_argument, "Cant compare iterators from different MagicalContainers");
+
+        return pos == other.pos; // compare position
+    }
+
+    MAGICAL_HOT_PATH bool MagicalContainer::BasicIterator::operator!=(const BasicIterator &other) const
+    {
+        MAGICAL_ITERATOR_CHECK(this->magicalContainer == other.magicalContainer, std::invalid_argument, "Cant compare iterators from different MagicalContainers");
+
+        return pos != other.pos; // compare position
+    }
+
+    MAGICAL_HOT_PATH bool MagicalContainer::BasicIterator::operator<(const BasicIterator &other) const
+    {
+        MAGICAL_ITERATOR_CHECK(this->magicalContainer == other.magicalContainer, std::invalid_argument, "Cant compare iterators from different MagicalContainers");
+
+        return pos < other.pos; // compare position
+    }
+
+    MAGICAL_HOT_PATH bool MagicalContainer::BasicIterator::operator>(const BasicIterator &other) const
+    {
+        MAGICAL_ITERATOR_CHECK(this->magicalContainer == other.magicalContainer, std::invalid_argument, "Cant compare iterators from different MagicalContainers");
+
+        return pos > other.pos; // compare position
+    }
+
+    MAGICAL_HOT_PATH size_t MagicalContainer::BasicIterator::position() const
+    {
+        return pos;
+    }
+
+    /*------------------------------------------
+    --------------ViewIterator------------------
+    --------------------------------------------*/
+
+    template <typename Derived>
+    MAGICAL_HOT_PATH bool MagicalContainer::ViewIterator<Derived>::operator==(std::default_sentinel_t) const
+    {
+        return pos >= derived().size(); // past the last element of the view
+    }
+
+    template <typename Derived>
+    MAGICAL_HOT_PATH bool MagicalContainer::ViewIterator<Derived>::operator!=(std::default_sentinel_t) const
+    {
+        return pos < derived().size();
+    }
+
+    /*------------------------------------------
+    --------------AscendingIterator-------------
+    --------------------------------------------*/
+
+    MAGICAL_HOT_PATH int MagicalContainer::AscendingIterator::operator*() const
+    {
+        MAGICAL_ITERATOR_CHECK(pos < magicalContainer->sortedElements.size(), std::runtime_error, "Iterator is out of range");
+        return *magicalContainer->sortedElements[pos]; // return value at position
+    }
+
+    MAGICAL_HOT_PATH MagicalContainer::AscendingIterator &MagicalContainer::AscendingIterator::operator++()
+    {
+        MAGICAL_ITERATOR_CHECK(pos < magicalContainer->sortedElements.size(), std::runtime_error, "Iterator is out of range");
+        ++pos; // increment position
+        return *this;
+    }
+
+    MAGICAL_HOT_PATH MagicalContainer::AscendingIterator &MagicalContainer::AscendingIterator::operator--()
+    {
+        MAGICAL_ITERATOR_CHECK(pos > 0, std::runtime_error, "Iterator is out of range");
+        --pos; // decrement position
+        return *this;
+    }
+
+    MAGICAL_HOT_PATH size_t MagicalContainer::AscendingIterator::size() const
+    {
+        return magicalContainer->sortedElements.size();
+    }
+
+    MAGICAL_HOT_PATH int MagicalContainer::AscendingIterator::operator[](size_t index) const
+    {
+        return *magicalContainer->sortedElements[index]; // unchecked, like std::vector::operator[]
+    }
+
+    /*------------------------------------------
+    --------------DescendingIterator------------
+    --------------------------------------------*/
+
+    MAGICAL_HOT_PATH int MagicalContainer::DescendingIterator::operator*() const
+    {
+        MAGICAL_ITERATOR_CHECK(pos < magicalContainer->sortedElements.size(), std::runtime_error, "Iterator is out of range");
+        return *magicalContainer->sortedElements[magicalContainer->sortedElements.size() - 1 - pos]; // counted from the back
+    }
+
+    MAGICAL_HOT_PATH MagicalContainer::DescendingIterator &MagicalContainer::DescendingIterator::operator++()
+    {
+        MAGICAL_ITERATOR_CHECK(pos < magicalContainer->sortedElements.size(), std::runtime_error, "Iterator is out of range");
+        ++pos; // increment position
+        return *this;
+    }
+
+    MAGICAL_HOT_PATH MagicalContainer::DescendingIterator &MagicalContainer::DescendingIterator::operator--()
+    {
+        MAGICAL_ITERATOR_CHECK(pos > 0, std::runtime_error, "Iterator is out of range");
+        --pos; // decrement position
+        return *this;
+    }
+
+    MAGICAL_HOT_PATH size_t MagicalContainer::DescendingIterator::size() const
+    {
+        return magicalContainer->sortedElements.size();
+    }
+
+    MAGICAL_HOT_PATH int MagicalContainer::DescendingIterator::operator[](size_t index) const
+    {
+        return *magicalContainer->sortedElements[magicalContainer->sortedElements.size() - 1 - index]; // unchecked, like std::vector::operator[]
+    }
+
+    /*------------------------------------------
+    --------------SideCrossIterator------------
+    --------------------------------------------*/
+
+    MAGICAL_HOT_PATH int MagicalContainer::SideCrossIterator::operator*() const
+    {
+        MAGICAL_ITERATOR_CHECK(pos < magicalContainer->crossElements.size(), std::runtime_error, "Iterator is out of range");
+        return *magicalContainer->crossElements[pos]; // return value at position
+    }
+
+    MAGICAL_HOT_PATH MagicalContainer::SideCrossIterator &MagicalContainer::SideCrossIterator::operator++()
+    {
+        MAGICAL_ITERATOR_CHECK(pos < magicalContainer->crossElements.size(), std::runtime_error, "Iterator is out of range");
+        ++pos; // increment position
+        return *this;
+    }
+
+    MAGICAL_HOT_PATH MagicalContainer::SideCrossIterator &MagicalContainer::SideCrossIterator::operator--()
+    {
+        MAGICAL_ITERATOR_CHECK(pos > 0, std::runtime_error, "Iterator is out of range");
+        --pos; // decrement position
+        return *this;
+    }
+
+    MAGICAL_HOT_PATH size_t MagicalContainer::SideCrossIterator::size() const
+    {
+        return magicalContainer->crossElements.size();
+    }
+
+    MAGICAL_HOT_PATH int MagicalContainer::SideCrossIterator::operator[](size_t index) const
+    {
+        return *magicalContainer->crossElements[index]; // unchecked, like std::vector::operator[]
+    }
+
+    /*------------------------------------------
+    --------------PrimeIterator-----------------
+    --------------------------------------------*/
+
+    MAGICAL_HOT_PATH int MagicalContainer::PrimeIterator::operator*() const
+    {
+        MAGICAL_ITERATOR_CHECK(pos < magicalContainer->primeElements.size(), std::runtime_error, "Iterator is out of range");
+        return *magicalContainer->primeElements[pos]; // return value at position
+    }
+
+    MAGICAL_HOT_PATH MagicalContainer::PrimeIterator &MagicalContainer::PrimeIterator::operator++()
+    {
+        MAGICAL_ITERATOR_CHECK(pos < magicalContainer->primeElements.size(), std::runtime_error, "Iterator is out of range");
+        ++pos; // increment position
+        return *this;
+    }
+
+    MAGICAL_HOT_PATH MagicalContainer::PrimeIterator &MagicalContainer::PrimeIterator::operator--()
+    {
+        MAGICAL_ITERATOR_CHECK(pos > 0, std::runtime_error, "Iterator is out of range");
+        --pos; // decrement position
+        return *this;
+    }
+
+    MAGICAL_HOT_PATH size_t MagicalContainer::PrimeIterator::size() const
+    {
+        return magicalContainer->primeElements.size();
+    }
+
+    MAGICAL_HOT_PATH int MagicalContainer::PrimeIterator::operator[](size_t index) const
+    {
+        return *magicalContainer->primeElements[index]; // unchecked, like std::vector::operator[]
+    }
+} // namespace ariel
@@ -0,0 +1,290 @@
+#include "MappedMagicalContainer.hpp"
+#include "MagicalContainer.hpp"
+#include "IteratorChecks.hpp"
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace ariel;
+using namespace std;
+
+/*------------------------------------------
+-----------MappedMagicalContainer-----------
+--------------------------------------------*/
+
+MappedMagicalContainer::MappedMagicalContainer(const std::string &path, bool validateViews)
+    : mapping(nullptr), mappingSize(0), elements(nullptr), sortedIndexes(nullptr), primeIndexes(nullptr), elementCount(0), primeCount(0)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Cant open snapshot file");
+
+    struct stat info
+    {
+    };
+    if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SnapshotHeader))
+    {
+        ::close(fd);
+        throw std::runtime_error("Not a valid snapshot file");
+    }
+
+    mappingSize = static_cast<size_t>(info.st_size);
+    mapping = ::mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+    if (mapping == MAP_FAILED)
+    {
+        mapping = nullptr;
+        throw std::runtime_error("Cant map snapshot file");
+    }
+
+    const auto *header = static_cast<const SnapshotHeader *>(mapping);
+    if (!isSnapshotHeader(*header) || snapshotSize(*header) != mappingSize)
+    {
+        ::munmap(mapping, mappingSize);
+        throw std::runtime_error("Not a valid snapshot file");
+    }
+
+    elementCount = static_cast<size_t>(header->elementCount);
+    primeCount = static_cast<size_t>(header->primeCount);
+    elements = reinterpret_cast<const int32_t *>(header + 1);
+    sortedIndexes = reinterpret_cast<const uint32_t *>(elements + elementCount);
+    primeIndexes = sortedIndexes + elementCount;
+
+    if (validateViews)
+    {
+        try
+        {
+            MagicalContainer::validateSnapshot(header->checksum, {elements, elementCount}, {sortedIndexes, elementCount},
+                                               {primeIndexes, primeCount}, false);
+        }
+        catch (...)
+        {
+            ::munmap(mapping, mappingSize);
+            throw;
+        }
+    }
+}
+
+MappedMagicalContainer::~MappedMagicalContainer()
+{
+    if (mapping != nullptr)
+        ::munmap(mapping, mappingSize);
+}
+
+MappedMagicalContainer::MappedMagicalContainer(MappedMagicalContainer &&other) noexcept
+    : mapping(std::exchange(other.mapping, nullptr)), mappingSize(std::exchange(other.mappingSize, 0)),
+      elements(std::exchange(other.elements, nullptr)), sortedIndexes(std::exchange(other.sortedIndexes, nullptr)),
+      primeIndexes(std::exchange(other.primeIndexes, nullptr)), elementCount(std::exchange(other.elementCount, 0)),
+      primeCount(std::exchange(other.primeCount, 0))
+{
+}
+
+MappedMagicalContainer &MappedMagicalContainer::operator=(MappedMagicalContainer &&other) noexcept
+{
+    if (this != &other)
+    {
+        if (mapping != nullptr)
+            ::munmap(mapping, mappingSize);
+        mapping = std::exchange(other.mapping, nullptr);
+        mappingSize = std::exchange(other.mappingSize, 0);
+        elements = std::exchange(other.elements, nullptr);
+        sortedIndexes = std::exchange(other.sortedIndexes, nullptr);
+        primeIndexes = std::exchange(other.primeIndexes, nullptr);
+        elementCount = std::exchange(other.elementCount, 0);
+        primeCount = std::exchange(other.primeCount, 0);
+    }
+    return *this;
+}
+
+size_t MappedMagicalContainer::size() const
+{
+    return elementCount;
+}
+
+/*------------------------------------------
+-------------------------------------------*/
+
+/*------------------------------------------
+--------------BasicIterator-------------
+--------------------------------------------*/
+
+MappedMagicalContainer::BasicIterator::BasicIterator(const MappedMagicalContainer &container) : container(&container), pos(0){};
+
+bool MappedMagicalContainer::BasicIterator::operator==(const BasicIterator &other) const
+{
+    MAGICAL_ITERATOR_CHECK(this->container == other.container, std::invalid_argument, "Cant compare iterators from different MappedMagicalContainers");
+
+    return pos == other.pos; // compare position
+}
+
+bool MappedMagicalContainer::BasicIterator::operator!=(const BasicIterator &other) const
+{
+    MAGICAL_ITERATOR_CHECK(this->container == other.container, std::invalid_argument, "Cant compare iterators from different MappedMagicalContainers");
+
+    return pos != other.pos; // compare position
+}
+
+bool MappedMagicalContainer::BasicIterator::operator<(const BasicIterator &other) const
+{
+    MAGICAL_ITERATOR_CHECK(this->container == other.container, std::invalid_argument, "Cant compare iterators from different MappedMagicalContainers");
+
+    return pos < other.pos; // compare position
+}
+
+bool MappedMagicalContainer::BasicIterator::operator>(const BasicIterator &other) const
+{
+    MAGICAL_ITERATOR_CHECK(this->container == other.container, std::invalid_argument, "Cant compare iterators from different MappedMagicalContainers");
+
+    return pos > other.pos; // compare position
+}
+
+size_t MappedMagicalContainer::BasicIterator::position() const
+{
+    return pos;
+}
+
+/*------------------------------------------
+-------------------------------------------*/
+
+/*------------------------------------------
+--------------AscendingIterator-------------
+--------------------------------------------*/
+
+MappedMagicalContainer::AscendingIterator::AscendingIterator(const MappedMagicalContainer &container) : BasicIterator(container){};
+
+int MappedMagicalContainer::AscendingIterator::operator*() const
+{
+    MAGICAL_ITERATOR_CHECK(pos < size(), std::runtime_error, "Iterator is out of range");
+    return (*this)[pos];
+}
+
+MappedMagicalContainer::AscendingIterator &MappedMagicalContainer::AscendingIterator::operator++()
+{
+    MAGICAL_ITERATOR_CHECK(pos < size(), std::runtime_error, "Iterator is out of range");
+    ++pos; // increment position
+    return *this;
+}
+
+size_t MappedMagicalContainer::AscendingIterator::size() const
+{
+    return container->elementCount;
+}
+
+int MappedMagicalContainer::AscendingIterator::operator[](size_t index) const
+{
+    return container->elements[container->sortedIndexes[index]];
+}
+
+MappedMagicalContainer::AscendingIterator MappedMagicalContainer::AscendingIterator::begin() const
+{
+    AscendingIterator temp(*this); // create copy of iterator
+    temp.pos = 0;                  // set position to 0
+    return temp;
+}
+
+MappedMagicalContainer::AscendingIterator MappedMagicalContainer::AscendingIterator::end() const
+{
+    AscendingIterator temp(*this); // create copy of iterator
+    temp.pos = size();             // set position to size of container
+    return temp;
+}
+
+/*------------------------------------------
+-------------------------------------------*/
+
+/*------------------------------------------
+--------------SideCrossIterator------------
+--------------------------------------------*/
+
+MappedMagicalContainer::SideCrossIterator::SideCrossIterator(const MappedMagicalContainer &container) : BasicIterator(container){};
+
+int MappedMagicalContainer::SideCrossIterator::operator*() const
+{
+    MAGICAL_ITERATOR_CHECK(pos < size(), std::runtime_error, "Iterator is out of range");
+    return (*this)[pos];
+}
+
+MappedMagicalContainer::SideCrossIterator &MappedMagicalContainer::SideCrossIterator::operator++()
+{
+    MAGICAL_ITERATOR_CHECK(pos < size(), std::runtime_error, "Iterator is out of range");
+    ++pos; // increment position
+    return *this;
+}
+
+size_t MappedMagicalContainer::SideCrossIterator::size() const
+{
+    return container->elementCount;
+}
+
+int MappedMagicalContainer::SideCrossIterator::operator[](size_t index) const
+{
+    // even positions walk the sorted view from the start, odd positions from the end
+    size_t sortedPos = index % 2 == 0 ? index / 2 : size() - 1 - index / 2;
+    return container->elements[container->sortedIndexes[sortedPos]];
+}
+
+MappedMagicalContainer::SideCrossIterator MappedMagicalContainer::SideCrossIterator::begin() const
+{
+    SideCrossIterator temp(*this); // create copy of iterator
+    temp.pos = 0;                  // set position to 0
+    return temp;
+}
+
+MappedMagicalContainer::SideCrossIterator MappedMagicalContainer::SideCrossIterator::end() const
+{
+    SideCrossIterator temp(*this); // create copy of iterator
+    temp.pos = size();             // set position to size of container
+    return temp;
+}
+
+/*------------------------------------------
+-------------------------------------------*/
+
+/*------------------------------------------
+--------------PrimeIterator-----------------
+--------------------------------------------*/
+
+MappedMagicalContainer::PrimeIterator::PrimeIterator(const MappedMagicalContainer &container) : BasicIterator(container){};
+
+int MappedMagicalContainer::PrimeIterator::operator*() const
+{
+    MAGICAL_ITERATOR_CHECK(pos < size(), std::runtime_error, "Iterator is out of range");
+    return (*this)[pos];
+}
+
+MappedMagicalContainer::PrimeIterator &MappedMagicalContainer::PrimeIterator::operator++()
+{
+    MAGICAL_ITERATOR_CHECK(pos < size(), std::runtime_error, "Iterator is out of range");
+    ++pos; // increment position
+    return *this;
+}
+
+size_t MappedMagicalContainer::PrimeIterator::size() const
+{
+    return container->primeCount;
+}
+
+int MappedMagicalContainer::PrimeIterator::operator[](size_t index) const
+{
+    return container->elements[container->primeIndexes[index]];
+}
+
+MappedMagicalContainer::PrimeIterator MappedMagicalContainer::PrimeIterator::begin() const
+{
+    PrimeIterator temp(*this); // create copy of iterator
+    temp.pos = 0;              // set position to 0
+    return temp;
+}
+
+MappedMagicalContainer::PrimeIterator MappedMagicalContainer::PrimeIterator::end() const
+{
+    PrimeIterator temp(*this); // create copy of iterator
+    temp.pos = size();         // set position to size of container
+    return temp;
+}
+
+/*------------------------------------------
+-------------------------------------------*/
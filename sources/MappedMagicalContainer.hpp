@@ -0,0 +1,108 @@
+#pragma once
+
+#include "SnapshotFormat.hpp"
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace ariel
+{
+
+    // Read-only container over a snapshot written by MagicalContainer::save(), memory mapped in place.
+    // Opening is O(1) apart from validating the header, the views are read straight from the mapped
+    // pages and processes mapping the same file share them through the page cache.
+    // The iterators mirror MagicalContainer's; the cross order is computed from the sorted indexes.
+    // By default only the header and file size are validated and the indexes inside the file are trusted,
+    // so a corrupt file can make the iterators read out of bounds. validateViews runs the same linear checks
+    // as MagicalContainer::load() (checksum and view structure) on the mapped sections and throws
+    // std::runtime_error on a mismatch.
+    class MappedMagicalContainer
+    {
+        void *mapping;
+        size_t mappingSize;
+        const int32_t *elements;
+        const uint32_t *sortedIndexes;
+        const uint32_t *primeIndexes;
+        size_t elementCount;
+        size_t primeCount;
+
+        class BasicIterator; // forward declaration of nested class
+
+    public:
+        explicit MappedMagicalContainer(const std::string &path, bool validateViews = false);
+        ~MappedMagicalContainer();
+        MappedMagicalContainer(const MappedMagicalContainer &other) = delete;
+        MappedMagicalContainer &operator=(const MappedMagicalContainer &other) = delete;
+        MappedMagicalContainer(MappedMagicalContainer &&other) noexcept;
+        MappedMagicalContainer &operator=(MappedMagicalContainer &&other) noexcept;
+
+        size_t size() const;
+
+        // Nested classes
+        class AscendingIterator;
+        class SideCrossIterator;
+        class PrimeIterator;
+    };
+
+    class MappedMagicalContainer::BasicIterator
+    {
+    protected:
+        const MappedMagicalContainer *container;
+        size_t pos;
+
+    public:
+        BasicIterator(const MappedMagicalContainer &container);
+
+        bool operator==(const BasicIterator &other) const;
+        bool operator!=(const BasicIterator &other) const;
+        bool operator>(const BasicIterator &other) const;
+        bool operator<(const BasicIterator &other) const;
+
+        size_t position() const; // index into the view this iterator walks
+    };
+
+    class MappedMagicalContainer::AscendingIterator : public MappedMagicalContainer::BasicIterator
+    {
+    public:
+        AscendingIterator(const MappedMagicalContainer &container);
+
+        int operator*() const;
+        AscendingIterator &operator++();
+
+        size_t size() const;
+        int operator[](size_t index) const;
+
+        AscendingIterator begin() const;
+        AscendingIterator end() const;
+    };
+
+    class MappedMagicalContainer::SideCrossIterator : public MappedMagicalContainer::BasicIterator
+    {
+    public:
+        SideCrossIterator(const MappedMagicalContainer &container);
+
+        int operator*() const;
+        SideCrossIterator &operator++();
+
+        size_t size() const;
+        int operator[](size_t index) const;
+
+        SideCrossIterator begin() const;
+        SideCrossIterator end() const;
+    };
+
+    class MappedMagicalContainer::PrimeIterator : public MappedMagicalContainer::BasicIterator
+    {
+    public:
+        PrimeIterator(const MappedMagicalContainer &container);
+
+        int operator*() const;
+        PrimeIterator &operator++();
+
+        size_t size() const;
+        int operator[](size_t index) const;
+
+        PrimeIterator begin() const;
+        PrimeIterator end() const;
+    };
+} // namespace ariel
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "ThreadPool.hpp"
+#include <vector>
+#include <algorithm>
+
+namespace ariel
+{
+    // Chunks handed to the pool per thread; more chunks give stealing room to balance uneven work
+    constexpr size_t CHUNKS_PER_THREAD = 4;
+
+    // Splits [first, last) into `chunks` nearly equal ranges and returns the bounds of range `index`
+    inline std::pair<size_t, size_t> chunkBounds(size_t first, size_t last, size_t chunks, size_t index)
+    {
+        size_t length = last - first;
+        return {first + length * index / chunks, first + length * (index + 1) / chunks};
+    }
+
+    inline size_t chunkCount(size_t length, const ThreadPool &pool)
+    {
+        return std::min(length, (pool.threadCount() + 1) * CHUNKS_PER_THREAD);
+    }
+
+    // Calls fn(value) for every element from the view's current position to its end.
+    // The view must not be modified while this runs; fn may run concurrently on several threads.
+    template <typename View, typename Function>
+    void parallel_for_each(const View &view, Function fn, ThreadPool &pool = ThreadPool::shared())
+    {
+        size_t first = std::min(view.position(), view.size());
+        size_t last = view.size();
+        size_t chunks = chunkCount(last - first, pool);
+
+        pool.run(chunks, [&](size_t chunk)
+                 {
+                     auto bounds = chunkBounds(first, last, chunks, chunk);
+                     for (size_t i = bounds.first; i < bounds.second; i++)
+                     {
+                         fn(view[i]);
+                     } });
+    }
+
+    // Folds the elements from the view's current position to its end with op, which must be associative.
+    // Every chunk is folded on its own and the partial results are combined in view order.
+    template <typename View, typename T, typename BinaryOp>
+    T parallel_reduce(const View &view, T init, BinaryOp op, ThreadPool &pool = ThreadPool::shared())
+    {
+        size_t first = std::min(view.position(), view.size());
+        size_t last = view.size();
+        size_t chunks = chunkCount(last - first, pool);
+        std::vector<T> partials(chunks);
+
+        pool.run(chunks, [&](size_t chunk)
+                 {
+                     auto bounds = chunkBounds(first, last, chunks, chunk);
+                     T partial = static_cast<T>(view[bounds.first]); // chunks are never empty
+                     for (size_t i = bounds.first + 1; i < bounds.second; i++)
+                     {
+                         partial = op(partial, view[i]);
+                     }
+                     partials[chunk] = partial; });
+
+        for (const T &partial : partials)
+        {
+            init = op(init, partial);
+        }
+        return init;
+    }
+} // namespace ariel
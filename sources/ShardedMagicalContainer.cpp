@@ -0,0 +1,490 @@
+#include "ShardedMagicalContainer.hpp"
+#include "IteratorChecks.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+
+using namespace ariel;
+using namespace std;
+
+/*------------------------------------------
+------------ShardedMagicalContainer---------
+--------------------------------------------*/
+
+ShardedMagicalContainer::ShardedMagicalContainer(size_t shardCount)
+{
+    if (shardCount == 0)
+        throw std::invalid_argument("ShardedMagicalContainer needs at least one shard");
+
+    shards.reserve(shardCount);
+    for (size_t i = 0; i < shardCount; i++)
+    {
+        shards.push_back(std::make_unique<Shard>());
+    }
+}
+
+// Private methods
+size_t ShardedMagicalContainer::shardOf(int element) const
+{
+    // Fibonacci hashing spreads consecutive values over all shards
+    uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(element)) * 11400714819323198485ULL;
+    return static_cast<size_t>(hash >> 32U) % shards.size();
+}
+
+// Public methods
+
+void ShardedMagicalContainer::addElement(int element)
+{
+    Shard &shard = *shards[shardOf(element)];
+    std::lock_guard<std::mutex> guard(shard.lock);
+    shard.container.addElement(element);
+}
+
+void ShardedMagicalContainer::addElements(std::span<const int> elements)
+{
+    std::vector<std::vector<int>> partitions(shards.size());
+    for (int element : elements)
+    {
+        partitions[shardOf(element)].push_back(element);
+    }
+    for (size_t i = 0; i < shards.size(); i++)
+    {
+        std::lock_guard<std::mutex> guard(shards[i]->lock);
+        shards[i]->container.addElements(partitions[i]);
+    }
+}
+
+void ShardedMagicalContainer::removeElement(int element)
+{
+    Shard &shard = *shards[shardOf(element)]; // equal values always land in the same shard
+    std::lock_guard<std::mutex> guard(shard.lock);
+    shard.container.removeElement(element);
+}
+
+size_t ShardedMagicalContainer::size() const
+{
+    size_t total = 0;
+    for (const auto &shard : shards)
+    {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        total += shard->container.size();
+    }
+    return total;
+}
+
+int64_t ShardedMagicalContainer::sum() const
+{
+    int64_t total = 0;
+    for (const auto &shard : shards)
+    {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        total += shard->container.sum();
+    }
+    return total;
+}
+
+int ShardedMagicalContainer::min() const
+{
+    bool found = false;
+    int result = 0;
+    for (const auto &shard : shards)
+    {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        if (shard->container.size() == 0)
+            continue;
+        int value = shard->container.min();
+        result = found ? std::min(result, value) : value;
+        found = true;
+    }
+    if (!found)
+        throw std::out_of_range("Minimum of an empty container");
+    return result;
+}
+
+int ShardedMagicalContainer::max() const
+{
+    bool found = false;
+    int result = 0;
+    for (const auto &shard : shards)
+    {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        if (shard->container.size() == 0)
+            continue;
+        int value = shard->container.max();
+        result = found ? std::max(result, value) : value;
+        found = true;
+    }
+    if (!found)
+        throw std::out_of_range("Maximum of an empty container");
+    return result;
+}
+
+size_t ShardedMagicalContainer::primeCount() const
+{
+    size_t total = 0;
+    for (const auto &shard : shards)
+    {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        total += shard->container.primeCount();
+    }
+    return total;
+}
+
+size_t ShardedMagicalContainer::shardCount() const
+{
+    return shards.size();
+}
+
+const MagicalContainer &ShardedMagicalContainer::shard(size_t index) const
+{
+    if (index >= shards.size())
+        throw std::out_of_range("Shard index is out of range");
+    return shards[index]->container;
+}
+
+/*------------------------------------------
+-------------------------------------------*/
+
+/*------------------------------------------
+--------------BasicIterator-------------
+--------------------------------------------*/
+
+ShardedMagicalContainer::BasicIterator::BasicIterator(ShardedMagicalContainer &container) : container(&container), pos(0){};
+
+const std::vector<int *> &ShardedMagicalContainer::BasicIterator::sortedView(size_t shard) const
+{
+    return container->shards[shard]->container.sortedElements;
+}
+
+const std::vector<int *> &ShardedMagicalContainer::BasicIterator::primeView(size_t shard) const
+{
+    return container->shards[shard]->container.primeElements;
+}
+
+size_t ShardedMagicalContainer::BasicIterator::liveSize() const
+{
+    size_t total = 0;
+    for (size_t shard = 0; shard < container->shards.size(); shard++)
+    {
+        total += sortedView(shard).size();
+    }
+    return total;
+}
+
+bool ShardedMagicalContainer::BasicIterator::operator==(const BasicIterator &other) const
+{
+    MAGICAL_ITERATOR_CHECK(this->container == other.container, std::invalid_argument, "Cant compare iterators from different ShardedMagicalContainers");
+
+    return pos == other.pos; // compare position
+}
+
+bool ShardedMagicalContainer::BasicIterator::operator!=(const BasicIterator &other) const
+{
+    MAGICAL_ITERATOR_CHECK(this->container == other.container, std::invalid_argument, "Cant compare iterators from different ShardedMagicalContainers");
+
+    return pos != other.pos; // compare position
+}
+
+bool ShardedMagicalContainer::BasicIterator::operator<(const BasicIterator &other) const
+{
+    MAGICAL_ITERATOR_CHECK(this->container == other.container, std::invalid_argument, "Cant compare iterators from different ShardedMagicalContainers");
+
+    return pos < other.pos; // compare position
+}
+
+bool ShardedMagicalContainer::BasicIterator::operator>(const BasicIterator &other) const
+{
+    MAGICAL_ITERATOR_CHECK(this->container == other.container, std::invalid_argument, "Cant compare iterators from different ShardedMagicalContainers");
+
+    return pos > other.pos; // compare position
+}
+
+/*------------------------------------------
+-------------------------------------------*/
+
+/*------------------------------------------
+--------------AscendingIterator-------------
+--------------------------------------------*/
+
+ShardedMagicalContainer::AscendingIterator::AscendingIterator(ShardedMagicalContainer &container) : BasicIterator(container)
+{
+    reset();
+}
+
+ShardedMagicalContainer::AscendingIterator::AscendingIterator(ShardedMagicalContainer &container, size_t endPosition)
+    : BasicIterator(container)
+{
+    pos = endPosition;
+}
+
+void ShardedMagicalContainer::AscendingIterator::reset()
+{
+    size_t shardCount = container->shards.size();
+    cursors.assign(shardCount, 0);
+    heap.clear();
+    pos = 0;
+
+    auto greater = [this](size_t a, size_t b)
+    { return *sortedView(a)[cursors[a]] > *sortedView(b)[cursors[b]]; };
+
+    for (size_t shard = 0; shard < shardCount; shard++)
+    {
+        if (!sortedView(shard).empty())
+        {
+            heap.push_back(shard);
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(), greater);
+}
+
+int ShardedMagicalContainer::AscendingIterator::operator*() const
+{
+    MAGICAL_ITERATOR_CHECK(!heap.empty(), std::runtime_error, "Iterator is out of range");
+    size_t shard = heap.front();
+    return *sortedView(shard)[cursors[shard]]; // smallest value under any cursor
+}
+
+ShardedMagicalContainer::AscendingIterator &ShardedMagicalContainer::AscendingIterator::operator++()
+{
+    MAGICAL_ITERATOR_CHECK(!heap.empty(), std::runtime_error, "Iterator is out of range");
+
+    auto greater = [this](size_t a, size_t b)
+    { return *sortedView(a)[cursors[a]] > *sortedView(b)[cursors[b]]; };
+
+    std::pop_heap(heap.begin(), heap.end(), greater);
+    size_t shard = heap.back();
+    if (++cursors[shard] < sortedView(shard).size())
+    {
+        std::push_heap(heap.begin(), heap.end(), greater); // shard still has elements, re-key it
+    }
+    else
+    {
+        heap.pop_back(); // shard exhausted
+    }
+    ++pos;
+    return *this;
+}
+
+bool ShardedMagicalContainer::AscendingIterator::operator==(std::default_sentinel_t) const
+{
+    return heap.empty();
+}
+
+bool ShardedMagicalContainer::AscendingIterator::operator!=(std::default_sentinel_t) const
+{
+    return !heap.empty();
+}
+
+ShardedMagicalContainer::AscendingIterator ShardedMagicalContainer::AscendingIterator::begin()
+{
+    AscendingIterator temp(*this); // create copy of iterator
+    temp.reset();                  // rewind every shard cursor
+    return temp;
+}
+
+ShardedMagicalContainer::AscendingIterator ShardedMagicalContainer::AscendingIterator::end()
+{
+    return AscendingIterator(*container, liveSize()); // past the last element of the live view, no cursors to copy
+}
+
+/*------------------------------------------
+-------------------------------------------*/
+
+/*------------------------------------------
+--------------SideCrossIterator------------
+--------------------------------------------*/
+
+ShardedMagicalContainer::SideCrossIterator::SideCrossIterator(ShardedMagicalContainer &container) : BasicIterator(container), total(0)
+{
+    reset();
+}
+
+ShardedMagicalContainer::SideCrossIterator::SideCrossIterator(ShardedMagicalContainer &container, size_t endPosition)
+    : BasicIterator(container), total(endPosition)
+{
+    pos = endPosition;
+}
+
+// Both heaps break ties on the shard index, so the front and back merges agree on a single
+// total order and never emit the same element while fewer than `total` elements were visited.
+void ShardedMagicalContainer::SideCrossIterator::reset()
+{
+    size_t shardCount = container->shards.size();
+    low.assign(shardCount, 0);
+    high.resize(shardCount);
+    frontHeap.clear();
+    backHeap.clear();
+    total = 0;
+    pos = 0;
+
+    for (size_t shard = 0; shard < shardCount; shard++)
+    {
+        high[shard] = sortedView(shard).size();
+        total += high[shard];
+        if (high[shard] > 0)
+        {
+            frontHeap.push_back(shard);
+            backHeap.push_back(shard);
+        }
+    }
+
+    auto frontGreater = [this](size_t a, size_t b)
+    {
+        int va = *sortedView(a)[low[a]], vb = *sortedView(b)[low[b]];
+        return va != vb ? va > vb : a > b;
+    };
+    auto backLess = [this](size_t a, size_t b)
+    {
+        int va = *sortedView(a)[high[a] - 1], vb = *sortedView(b)[high[b] - 1];
+        return va != vb ? va < vb : a < b;
+    };
+    std::make_heap(frontHeap.begin(), frontHeap.end(), frontGreater);
+    std::make_heap(backHeap.begin(), backHeap.end(), backLess);
+}
+
+bool ShardedMagicalContainer::SideCrossIterator::fromStart() const
+{
+    return pos % 2 == 0; // one from the start then one from the end
+}
+
+int ShardedMagicalContainer::SideCrossIterator::operator*() const
+{
+    MAGICAL_ITERATOR_CHECK(pos < total, std::runtime_error, "Iterator is out of range");
+    if (fromStart())
+    {
+        size_t shard = frontHeap.front();
+        return *sortedView(shard)[low[shard]];
+    }
+    size_t shard = backHeap.front();
+    return *sortedView(shard)[high[shard] - 1];
+}
+
+ShardedMagicalContainer::SideCrossIterator &ShardedMagicalContainer::SideCrossIterator::operator++()
+{
+    MAGICAL_ITERATOR_CHECK(pos < total, std::runtime_error, "Iterator is out of range");
+
+    if (fromStart())
+    {
+        auto frontGreater = [this](size_t a, size_t b)
+        {
+            int va = *sortedView(a)[low[a]], vb = *sortedView(b)[low[b]];
+            return va != vb ? va > vb : a > b;
+        };
+        std::pop_heap(frontHeap.begin(), frontHeap.end(), frontGreater);
+        size_t shard = frontHeap.back();
+        if (++low[shard] < sortedView(shard).size())
+            std::push_heap(frontHeap.begin(), frontHeap.end(), frontGreater);
+        else
+            frontHeap.pop_back();
+    }
+    else
+    {
+        auto backLess = [this](size_t a, size_t b)
+        {
+            int va = *sortedView(a)[high[a] - 1], vb = *sortedView(b)[high[b] - 1];
+            return va != vb ? va < vb : a < b;
+        };
+        std::pop_heap(backHeap.begin(), backHeap.end(), backLess);
+        size_t shard = backHeap.back();
+        if (--high[shard] > 0)
+            std::push_heap(backHeap.begin(), backHeap.end(), backLess);
+        else
+            backHeap.pop_back();
+    }
+    ++pos;
+    return *this;
+}
+
+bool ShardedMagicalContainer::SideCrossIterator::operator==(std::default_sentinel_t) const
+{
+    return pos >= total;
+}
+
+bool ShardedMagicalContainer::SideCrossIterator::operator!=(std::default_sentinel_t) const
+{
+    return pos < total;
+}
+
+ShardedMagicalContainer::SideCrossIterator ShardedMagicalContainer::SideCrossIterator::begin()
+{
+    SideCrossIterator temp(*this); // create copy of iterator
+    temp.reset();                  // rewind both merges
+    return temp;
+}
+
+ShardedMagicalContainer::SideCrossIterator ShardedMagicalContainer::SideCrossIterator::end()
+{
+    return SideCrossIterator(*container, liveSize()); // past the last element of the live view, no heaps to copy
+}
+
+/*------------------------------------------
+-------------------------------------------*/
+
+/*------------------------------------------
+--------------PrimeIterator-----------------
+--------------------------------------------*/
+
+ShardedMagicalContainer::PrimeIterator::PrimeIterator(ShardedMagicalContainer &container) : BasicIterator(container), shardIndex(0), index(0)
+{
+    skipEmpty();
+}
+
+void ShardedMagicalContainer::PrimeIterator::skipEmpty()
+{
+    while (shardIndex < container->shards.size() && index >= primeView(shardIndex).size())
+    {
+        ++shardIndex; // move on to the next shard with primes left
+        index = 0;
+    }
+}
+
+int ShardedMagicalContainer::PrimeIterator::operator*() const
+{
+    MAGICAL_ITERATOR_CHECK(shardIndex < container->shards.size(), std::runtime_error, "Iterator is out of range");
+    return *primeView(shardIndex)[index];
+}
+
+ShardedMagicalContainer::PrimeIterator &ShardedMagicalContainer::PrimeIterator::operator++()
+{
+    MAGICAL_ITERATOR_CHECK(shardIndex < container->shards.size(), std::runtime_error, "Iterator is out of range");
+    ++index;
+    ++pos;
+    skipEmpty();
+    return *this;
+}
+
+bool ShardedMagicalContainer::PrimeIterator::operator==(std::default_sentinel_t) const
+{
+    return shardIndex >= container->shards.size();
+}
+
+bool ShardedMagicalContainer::PrimeIterator::operator!=(std::default_sentinel_t) const
+{
+    return shardIndex < container->shards.size();
+}
+
+ShardedMagicalContainer::PrimeIterator ShardedMagicalContainer::PrimeIterator::begin()
+{
+    PrimeIterator temp(*this); // create copy of iterator
+    temp.shardIndex = 0;
+    temp.index = 0;
+    temp.pos = 0;
+    temp.skipEmpty();
+    return temp;
+}
+
+ShardedMagicalContainer::PrimeIterator ShardedMagicalContainer::PrimeIterator::end()
+{
+    PrimeIterator temp(*this); // create copy of iterator
+    temp.shardIndex = container->shards.size();
+    temp.index = 0;
+    temp.pos = 0;
+    for (size_t shard = 0; shard < container->shards.size(); shard++)
+    {
+        temp.pos += primeView(shard).size(); // set position to number of primes
+    }
+    return temp;
+}
+
+/*------------------------------------------
+-------------------------------------------*/
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "MagicalContainer.hpp"
+#include <vector>
+#include <memory>
+#include <mutex>
+
+namespace ariel
+{
+
+    // Partitions values by hash into independent MagicalContainer shards, each guarded by its own lock,
+    // so concurrent addElement/removeElement calls on different shards do not contend.
+    // Iteration is not synchronized: iterate only while no thread is mutating the container.
+    class ShardedMagicalContainer
+    {
+        struct Shard
+        {
+            MagicalContainer container;
+            mutable std::mutex lock;
+        };
+
+        std::vector<std::unique_ptr<Shard>> shards; // shards are heap allocated because std::mutex is not movable
+
+        size_t shardOf(int element) const;
+
+        class BasicIterator; // forward declaration of nested class
+
+    public:
+        static constexpr size_t DEFAULT_SHARDS = 8;
+
+        explicit ShardedMagicalContainer(size_t shardCount = DEFAULT_SHARDS);
+        ~ShardedMagicalContainer() = default;
+        ShardedMagicalContainer(const ShardedMagicalContainer &other) = delete;
+        ShardedMagicalContainer &operator=(const ShardedMagicalContainer &other) = delete;
+        ShardedMagicalContainer(ShardedMagicalContainer &&other) noexcept = default;
+        ShardedMagicalContainer &operator=(ShardedMagicalContainer &&other) noexcept = default;
+
+        void addElement(int element);
+        void addElements(std::span<const int> elements); // partitions the batch, one bulk insert per shard
+        void removeElement(int element);
+        size_t size() const;
+
+        // Combined from every shard's O(1) aggregates, O(shards). min() and max() throw std::out_of_range when empty.
+        int64_t sum() const;
+        int min() const;
+        int max() const;
+        size_t primeCount() const;
+
+        size_t shardCount() const;
+        const MagicalContainer &shard(size_t index) const;
+
+        // Nested classes
+        class AscendingIterator;
+        class SideCrossIterator;
+        class PrimeIterator;
+    };
+
+    class ShardedMagicalContainer::BasicIterator
+    {
+    protected:
+        ShardedMagicalContainer *container;
+        size_t pos; // number of elements already visited
+
+        const std::vector<int *> &sortedView(size_t shard) const;
+        const std::vector<int *> &primeView(size_t shard) const;
+        size_t liveSize() const; // elements over all shards right now, without locking (iteration is unsynchronized)
+
+    public:
+        BasicIterator(ShardedMagicalContainer &container);
+
+        bool operator==(const BasicIterator &other) const;
+        bool operator!=(const BasicIterator &other) const;
+        bool operator>(const BasicIterator &other) const;
+        bool operator<(const BasicIterator &other) const;
+    };
+
+    // k-way heap merge over the shards' sorted views, O(log k) per increment.
+    // end() carries no merge state, so `it != view.end()` loops stay allocation and lock free.
+    class ShardedMagicalContainer::AscendingIterator : public ShardedMagicalContainer::BasicIterator
+    {
+        std::vector<size_t> cursors; // next unread index into every shard's sorted view
+        std::vector<size_t> heap;    // min-heap of shard indexes keyed by the value under their cursor
+
+        void reset();
+        AscendingIterator(ShardedMagicalContainer &container, size_t endPosition); // end(), no merge state
+
+    public:
+        AscendingIterator(ShardedMagicalContainer &container);
+
+        int operator*() const;
+        AscendingIterator &operator++();
+
+        // Loop termination against std::default_sentinel: true once the merge is exhausted
+        using BasicIterator::operator==;
+        using BasicIterator::operator!=;
+        bool operator==(std::default_sentinel_t) const;
+        bool operator!=(std::default_sentinel_t) const;
+
+        AscendingIterator begin();
+        AscendingIterator end();
+    };
+
+    // Alternates between a min-heap merge from the front and a max-heap merge from the back
+    // of the shards' sorted views, producing the same order as MagicalContainer::SideCrossIterator.
+    class ShardedMagicalContainer::SideCrossIterator : public ShardedMagicalContainer::BasicIterator
+    {
+        std::vector<size_t> low;      // next unread index from the front of every shard's sorted view
+        std::vector<size_t> high;     // one past the next unread index from the back of every shard's sorted view
+        std::vector<size_t> frontHeap; // min-heap of shard indexes keyed by sortedView[low]
+        std::vector<size_t> backHeap;  // max-heap of shard indexes keyed by sortedView[high - 1]
+        size_t total;
+
+        void reset();
+        bool fromStart() const;
+        SideCrossIterator(ShardedMagicalContainer &container, size_t endPosition); // end(), no merge state
+
+    public:
+        SideCrossIterator(ShardedMagicalContainer &container);
+
+        int operator*() const;
+        SideCrossIterator &operator++();
+
+        // Loop termination against std::default_sentinel: true once every element was visited
+        using BasicIterator::operator==;
+        using BasicIterator::operator!=;
+        bool operator==(std::default_sentinel_t) const;
+        bool operator!=(std::default_sentinel_t) const;
+
+        SideCrossIterator begin();
+        SideCrossIterator end();
+    };
+
+    // Concatenates the shards' prime views, shard by shard.
+    class ShardedMagicalContainer::PrimeIterator : public ShardedMagicalContainer::BasicIterator
+    {
+        size_t shardIndex;
+        size_t index; // index into the prime view of the current shard
+
+        void skipEmpty();
+
+    public:
+        PrimeIterator(ShardedMagicalContainer &container);
+
+        int operator*() const;
+        PrimeIterator &operator++();
+
+        // Loop termination against std::default_sentinel: true past the last shard
+        using BasicIterator::operator==;
+        using BasicIterator::operator!=;
+        bool operator==(std::default_sentinel_t) const;
+        bool operator!=(std::default_sentinel_t) const;
+
+        PrimeIterator begin();
+        PrimeIterator end();
+    };
+} // namespace ariel
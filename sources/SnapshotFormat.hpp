@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+namespace ariel
+{
+
+    // On-disk layout written by MagicalContainer::save(), in native byte order:
+    //
+    //   SnapshotHeader                        checksum covers the three sections below
+    //   int32_t  elements[elementCount]      original insertion order
+    //   uint32_t sorted[elementCount]        indexes into elements, ascending by value
+    //   uint32_t primes[primeCount]          indexes into elements of the primes, insertion order
+    //
+    // Every section is 4-byte aligned so the file can be used in place.
+    struct SnapshotHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t elementCount;
+        uint64_t primeCount;
+        uint64_t checksum; // snapshotChecksum() of the sections, added in version 2
+    };
+
+    constexpr char SNAPSHOT_MAGIC[4] = {'M', 'G', 'C', 'N'};
+    constexpr uint32_t SNAPSHOT_VERSION = 2;
+
+    inline bool isSnapshotHeader(const SnapshotHeader &header)
+    {
+        return std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0 && header.version == SNAPSHOT_VERSION;
+    }
+
+    // Size in bytes of a snapshot with the given header, or 0 when the counts cannot be valid
+    inline uint64_t snapshotSize(const SnapshotHeader &header)
+    {
+        if (header.elementCount > UINT32_MAX || header.primeCount > header.elementCount)
+            return 0;
+        return sizeof(SnapshotHeader) + header.elementCount * (sizeof(int32_t) + sizeof(uint32_t)) + header.primeCount * sizeof(uint32_t);
+    }
+
+    // FNV-1a over the 32 bit words of the sections, detects corruption without primality tests
+    inline uint64_t snapshotChecksum(std::span<const int32_t> elements, std::span<const uint32_t> sorted, std::span<const uint32_t> primes)
+    {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        auto mix = [&hash](uint32_t word)
+        { hash = (hash ^ word) * 0x100000001b3ULL; };
+        for (int32_t element : elements)
+        {
+            mix(static_cast<uint32_t>(element));
+        }
+        for (uint32_t index : sorted)
+        {
+            mix(index);
+        }
+        for (uint32_t index : primes)
+        {
+            mix(index);
+        }
+        return hash;
+    }
+} // namespace ariel
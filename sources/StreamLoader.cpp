@@ -0,0 +1,217 @@
+#include "StreamLoader.hpp"
+#include "BoundedQueue.hpp"
+#include <charconv>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <exception>
+#include <stdexcept>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    bool isSeparator(char c)
+    {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+}
+
+// Private methods
+
+// Parses every complete token in pending and keeps the trailing partial one for the next block
+void StreamLoader::parseText(std::vector<char> &pending, bool last, Batch &batch)
+{
+    const char *cursor = pending.data();
+    const char *end = pending.data() + pending.size();
+    const char *stop = end;
+    if (!last)
+    {
+        while (stop != cursor && !isSeparator(*(stop - 1)))
+        {
+            --stop; // the token touching the end of the block may continue in the next one
+        }
+    }
+
+    while (cursor != stop)
+    {
+        if (isSeparator(*cursor))
+        {
+            ++cursor;
+            continue;
+        }
+        int value = 0;
+        auto result = std::from_chars(cursor, stop, value);
+        if (result.ec != std::errc() || (result.ptr != stop && !isSeparator(*result.ptr)))
+            throw std::runtime_error("Invalid integer in input stream");
+        batch.values.push_back(value);
+        cursor = result.ptr;
+    }
+    pending.erase(pending.begin(), pending.begin() + (stop - pending.data()));
+}
+
+// Copies whole int32 values and keeps the trailing partial one for the next block
+void StreamLoader::parseBinary(std::vector<char> &pending, bool last, Batch &batch)
+{
+    size_t count = pending.size() / sizeof(int32_t);
+    if (last && pending.size() % sizeof(int32_t) != 0)
+        throw std::runtime_error("Binary input stream ends in the middle of a value");
+
+    if (count == 0)
+        return;
+
+    size_t offset = batch.values.size();
+    batch.values.resize(offset + count);
+    std::memcpy(batch.values.data() + offset, pending.data(), count * sizeof(int32_t));
+    pending.erase(pending.begin(), pending.begin() + static_cast<ptrdiff_t>(count * sizeof(int32_t)));
+}
+
+void StreamLoader::classify(Batch &batch)
+{
+    batch.primeFlags.resize(batch.values.size());
+    for (size_t i = 0; i < batch.values.size(); i++)
+    {
+        batch.primeFlags[i] = MagicalContainer::isPrimeNumber(batch.values[i]) ? 1 : 0; // uncounted, runs off the container's thread
+    }
+}
+
+void StreamLoader::insert(MagicalContainer &container, const Batch &batch)
+{
+    container.appendElements(batch.values, batch.primeFlags);
+}
+
+// Public methods
+
+size_t StreamLoader::load(MagicalContainer &container, int fd, const Options &options)
+{
+    size_t blockSize = options.blockSize > 0 ? options.blockSize : 1;
+    BoundedQueue<std::vector<char>> blocks(options.queueDepth);
+    BoundedQueue<Batch> batches(options.queueDepth);
+
+    std::mutex failureLock;
+    std::exception_ptr failure;
+    auto fail = [&](std::exception_ptr error)
+    {
+        {
+            std::lock_guard<std::mutex> guard(failureLock);
+            if (!failure)
+                failure = error;
+        }
+        blocks.close();
+        batches.close();
+    };
+
+    std::thread reader([&]
+                       {
+        try
+        {
+            while (true)
+            {
+                std::vector<char> block(blockSize);
+                ssize_t got = ::read(fd, block.data(), blockSize);
+                if (got < 0 && errno == EINTR)
+                    continue;
+                if (got < 0)
+                    throw std::runtime_error("Failed reading input stream");
+                if (got == 0)
+                    break;
+                block.resize(static_cast<size_t>(got));
+                if (!blocks.push(std::move(block)))
+                    return; // a later stage gave up
+            }
+            blocks.close();
+        }
+        catch (...)
+        {
+            fail(std::current_exception());
+        } });
+
+    std::thread parser([&]
+                       {
+        try
+        {
+            std::vector<char> pending;
+            bool last = false;
+            while (!last)
+            {
+                auto block = blocks.pop();
+                last = !block.has_value();
+                if (block)
+                    pending.insert(pending.end(), block->begin(), block->end());
+
+                Batch batch;
+                if (options.format == Format::Text)
+                    parseText(pending, last, batch);
+                else
+                    parseBinary(pending, last, batch);
+                classify(batch);
+                if (!batch.values.empty() && !batches.push(std::move(batch)))
+                    return;
+            }
+            std::lock_guard<std::mutex> guard(failureLock);
+            if (!failure)
+                batches.close(); // a failed reader already closed it
+        }
+        catch (...)
+        {
+            fail(std::current_exception());
+        } });
+
+    size_t added = 0;
+    try
+    {
+        while (auto batch = batches.pop())
+        {
+            // fold in everything that queued up while the last merge ran, one merge per round
+            while (auto more = batches.tryPop())
+            {
+                batch->values.insert(batch->values.end(), more->values.begin(), more->values.end());
+                batch->primeFlags.insert(batch->primeFlags.end(), more->primeFlags.begin(), more->primeFlags.end());
+            }
+            insert(container, *batch);
+            added += batch->values.size();
+        }
+    }
+    catch (...)
+    {
+        fail(std::current_exception());
+    }
+
+    reader.join();
+    parser.join();
+    if (failure)
+        std::rethrow_exception(failure);
+    return added;
+}
+
+size_t StreamLoader::loadFile(MagicalContainer &container, const std::string &path, const Options &options)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Cant open input file");
+    try
+    {
+        size_t added = load(container, fd, options);
+        ::close(fd);
+        return added;
+    }
+    catch (...)
+    {
+        ::close(fd);
+        throw;
+    }
+}
+
+size_t StreamLoader::load(MagicalContainer &container, int fd)
+{
+    return load(container, fd, Options());
+}
+
+size_t StreamLoader::loadFile(MagicalContainer &container, const std::string &path)
+{
+    return loadFile(container, path, Options());
+}
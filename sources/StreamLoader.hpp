@@ -0,0 +1,53 @@
+#pragma once
+
+#include "MagicalContainer.hpp"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace ariel
+{
+
+    // Streams integers from a file descriptor into a MagicalContainer through a three stage pipeline:
+    //
+    //   reader thread     read() fixed-size blocks
+    //   parser thread     std::from_chars (or raw int32 copy) and prime classification
+    //   calling thread    bulk insertion, coalescing every batch already waiting
+    //
+    // with a bounded queue between each pair of stages, so I/O, parsing and view maintenance overlap.
+    // Elements inserted before an error stay in the container.
+    class StreamLoader
+    {
+    public:
+        enum class Format
+        {
+            Text,  // integers separated by whitespace
+            Binary // native-endian int32 values back to back
+        };
+
+        struct Options
+        {
+            Format format = Format::Text;
+            size_t blockSize = 1 << 16; // bytes per read()
+            size_t queueDepth = 8;      // blocks or batches buffered between two stages
+        };
+
+        // Returns the number of elements added. Does not close fd.
+        static size_t load(MagicalContainer &container, int fd, const Options &options);
+        static size_t load(MagicalContainer &container, int fd);
+        static size_t loadFile(MagicalContainer &container, const std::string &path, const Options &options);
+        static size_t loadFile(MagicalContainer &container, const std::string &path);
+
+    private:
+        struct Batch
+        {
+            std::vector<int> values;
+            std::vector<uint8_t> primeFlags;
+        };
+
+        static void parseText(std::vector<char> &pending, bool last, Batch &batch);
+        static void parseBinary(std::vector<char> &pending, bool last, Batch &batch);
+        static void classify(Batch &batch);
+        static void insert(MagicalContainer &container, const Batch &batch);
+    };
+} // namespace ariel
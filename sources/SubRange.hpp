@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+
+namespace ariel
+{
+
+    // A [first, last) slice of one of the container views, as produced by the iterators' split().
+    // Iterator must provide position() and atPosition(index).
+    template <typename Iterator>
+    class SubRange
+    {
+        Iterator first;
+        Iterator last;
+
+    public:
+        SubRange(Iterator first, Iterator last) : first(first), last(last) {}
+
+        Iterator begin() const { return first; }
+        Iterator end() const { return last; }
+        size_t size() const { return last.position() - first.position(); }
+        bool empty() const { return size() == 0; }
+
+        // Hands the front half to the caller and keeps the back half, in O(1).
+        // Returns nothing when fewer than two elements are left.
+        std::optional<SubRange> trySplit()
+        {
+            if (size() < 2)
+                return std::nullopt;
+            Iterator middle = first.atPosition(first.position() + size() / 2);
+            SubRange prefix(first, middle);
+            first = middle;
+            return prefix;
+        }
+    };
+} // namespace ariel
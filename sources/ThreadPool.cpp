@@ -0,0 +1,168 @@
+#include "ThreadPool.hpp"
+
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    thread_local bool insidePool = false; // set on workers and on a caller while it runs a batch
+}
+
+ThreadPool::ThreadPool(size_t threads) : generation(0), stopping(false), remaining(0)
+{
+    size_t workerCount = threads > 1 ? threads - 1 : 0; // the calling thread works too
+    for (size_t i = 0; i <= workerCount; i++)
+    {
+        lanes.push_back(std::make_unique<Lane>());
+    }
+    workers.reserve(workerCount);
+    for (size_t i = 1; i <= workerCount; i++)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::threadCount() const
+{
+    return workers.size();
+}
+
+ThreadPool &ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+// Private methods
+bool ThreadPool::takeTask(size_t lane, Task &task)
+{
+    {
+        Lane &own = *lanes[lane];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.tasks.empty())
+        {
+            task = own.tasks.back(); // newest first keeps the owner on a contiguous block
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < lanes.size(); offset++)
+    {
+        Lane &victim = *lanes[(lane + offset) % lanes.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty())
+        {
+            task = victim.tasks.front(); // steal the oldest, farthest from the victim's work
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::drain(size_t lane)
+{
+    Task task;
+    while (takeTask(lane, task))
+    {
+        try
+        {
+            (*task.first)(task.second);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            if (!failure)
+                failure = std::current_exception();
+        }
+        if (remaining.fetch_sub(1) == 1)
+        {
+            std::lock_guard<std::mutex> guard(sleepLock); // last task of the batch
+            done.notify_all();
+        }
+    }
+}
+
+void ThreadPool::workerLoop(size_t lane)
+{
+    insidePool = true;
+    size_t seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> guard(sleepLock);
+            wake.wait(guard, [&]
+                      { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+        drain(lane);
+    }
+}
+
+// Public methods
+
+void ThreadPool::run(size_t tasks, const std::function<void(size_t)> &job)
+{
+    if (tasks == 0)
+        return;
+
+    if (insidePool || workers.empty())
+    {
+        for (size_t i = 0; i < tasks; i++)
+        {
+            job(i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> batchGuard(batchLock);
+    insidePool = true;
+    failure = nullptr;
+    remaining = tasks;
+
+    // hand every lane a contiguous block of task indexes
+    size_t laneCount = lanes.size();
+    for (size_t lane = 0; lane < laneCount; lane++)
+    {
+        size_t first = tasks * lane / laneCount;
+        size_t last = tasks * (lane + 1) / laneCount;
+        std::lock_guard<std::mutex> guard(lanes[lane]->lock);
+        for (size_t i = first; i < last; i++)
+        {
+            lanes[lane]->tasks.emplace_back(&job, i);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        ++generation;
+    }
+    wake.notify_all();
+
+    drain(0);
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> guard(sleepLock);
+        done.wait(guard, [&]
+                  { return remaining == 0; });
+        error = failure;
+    }
+    insidePool = false;
+    if (error)
+        std::rethrow_exception(error);
+}
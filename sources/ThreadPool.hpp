@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <exception>
+
+namespace ariel
+{
+
+    // Fixed-size work-stealing pool. run() spreads a batch of task indexes over one deque per lane
+    // (every worker plus the calling thread); a lane pops from the back of its own deque and steals
+    // from the front of the others once it runs dry.
+    class ThreadPool
+    {
+        using Task = std::pair<const std::function<void(size_t)> *, size_t>; // job of the batch and task index
+
+        struct Lane
+        {
+            std::deque<Task> tasks;
+            std::mutex lock;
+        };
+
+        std::vector<std::unique_ptr<Lane>> lanes; // lane 0 belongs to the thread calling run()
+        std::vector<std::thread> workers;
+
+        std::mutex batchLock; // one batch runs at a time
+        std::mutex sleepLock;
+        std::condition_variable wake;
+        std::condition_variable done;
+        size_t generation;
+        bool stopping;
+
+        std::atomic<size_t> remaining;
+        std::exception_ptr failure;
+
+        bool takeTask(size_t lane, Task &task);
+        void drain(size_t lane);
+        void workerLoop(size_t lane);
+
+    public:
+        explicit ThreadPool(size_t threads = std::thread::hardware_concurrency());
+        ~ThreadPool();
+        ThreadPool(const ThreadPool &other) = delete;
+        ThreadPool &operator=(const ThreadPool &other) = delete;
+        ThreadPool(ThreadPool &&other) = delete;
+        ThreadPool &operator=(ThreadPool &&other) = delete;
+
+        size_t threadCount() const; // worker threads, not counting the caller
+
+        // Runs job(0) ... job(tasks - 1) and returns once all of them finished.
+        // The first exception thrown by a task is rethrown here. Nested calls run inline.
+        void run(size_t tasks, const std::function<void(size_t)> &job);
+
+        static ThreadPool &shared(); // process-wide pool sized to the hardware
+    };
+} // namespace ariel
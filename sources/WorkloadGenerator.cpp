@@ -0,0 +1,181 @@
+#include "WorkloadGenerator.hpp"
+#include <cmath>
+#include <stdexcept>
+
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    const uint64_t ZETA_EXACT_TERMS = 1000000; // beyond this the zeta sum is approximated by its integral
+}
+
+WorkloadGenerator::WorkloadGenerator(const WorkloadSpec &spec)
+    : spec(spec), random(spec.seed), produced(0), sequence(0), zipfZetaN(0), zipfAlpha(0), zipfEta(0)
+{
+    if (spec.valueRange <= 0)
+        throw std::invalid_argument("Workload value range must be positive");
+    if (spec.insertRatio < 0 || spec.removeRatio < 0 || spec.scanRatio < 0 || spec.insertRatio + spec.removeRatio + spec.scanRatio <= 0)
+        throw std::invalid_argument("Workload ratios must be non negative and not all zero");
+
+    if (spec.distribution == Distribution::Zipfian && (spec.zipfSkew <= 0 || spec.zipfSkew >= 1))
+        throw std::invalid_argument("Zipfian skew must be in (0, 1)");
+    if (spec.distribution == Distribution::PrimeHeavy && spec.valueRange <= 2)
+        throw std::invalid_argument("Prime-heavy value range holds no prime");
+
+    if (spec.distribution == Distribution::Zipfian)
+    {
+        double theta = spec.zipfSkew;
+        auto items = static_cast<uint64_t>(spec.valueRange);
+        uint64_t exact = std::min(items, ZETA_EXACT_TERMS);
+        for (uint64_t i = 1; i <= exact; i++)
+        {
+            zipfZetaN += 1.0 / std::pow(static_cast<double>(i), theta);
+        }
+        if (items > exact)
+        {
+            double n = static_cast<double>(items);
+            double m = static_cast<double>(exact);
+            zipfZetaN += (std::pow(n, 1 - theta) - std::pow(m, 1 - theta)) / (1 - theta);
+        }
+        double zeta2 = 1 + 1 / std::pow(2.0, theta);
+        zipfAlpha = 1 / (1 - theta);
+        zipfEta = (1 - std::pow(2.0 / static_cast<double>(items), 1 - theta)) / (1 - zeta2 / zipfZetaN);
+    }
+}
+
+// Private methods
+bool WorkloadGenerator::isPrime(int32_t value)
+{
+    if (value <= 1)
+        return false;
+    for (int64_t i = 2; i * i <= value; i++)
+    {
+        if (value % i == 0)
+            return false;
+    }
+    return true;
+}
+
+int32_t WorkloadGenerator::zipfValue()
+{
+    double u = std::uniform_real_distribution<double>(0, 1)(random);
+    double uz = u * zipfZetaN;
+    if (uz < 1)
+        return 0;
+    if (uz < 1 + std::pow(0.5, spec.zipfSkew))
+        return 1;
+    auto rank = static_cast<int64_t>(static_cast<double>(spec.valueRange) * std::pow(zipfEta * u - zipfEta + 1, zipfAlpha));
+    return static_cast<int32_t>(std::min<int64_t>(rank, spec.valueRange - 1));
+}
+
+int32_t WorkloadGenerator::nextValue()
+{
+    std::uniform_int_distribution<int32_t> uniform(0, spec.valueRange - 1);
+    switch (spec.distribution)
+    {
+    case Distribution::Zipfian:
+        return zipfValue();
+    case Distribution::Presorted:
+        return static_cast<int32_t>(sequence++ % spec.valueRange);
+    case Distribution::ReverseSorted:
+        return static_cast<int32_t>(spec.valueRange - 1 - sequence++ % spec.valueRange);
+    case Distribution::PrimeHeavy:
+    {
+        int32_t value = uniform(random);
+        if (std::uniform_real_distribution<double>(0, 1)(random) < spec.primeShare)
+        {
+            while (!isPrime(value))
+            {
+                value = value < spec.valueRange - 1 ? value + 1 : 2; // walk up to the next prime, 2 is in range (see constructor)
+            }
+        }
+        return value;
+    }
+    case Distribution::DuplicateHeavy:
+    {
+        auto pool = static_cast<int32_t>(std::min<size_t>(std::max<size_t>(spec.duplicatePool, 1), static_cast<size_t>(spec.valueRange)));
+        return std::uniform_int_distribution<int32_t>(0, pool - 1)(random);
+    }
+    default:
+        return uniform(random);
+    }
+}
+
+// Public methods
+
+std::vector<int32_t> WorkloadGenerator::initialValues()
+{
+    std::vector<int32_t> values(spec.initialSize);
+    for (int32_t &value : values)
+    {
+        value = nextValue();
+    }
+    live.insert(live.end(), values.begin(), values.end());
+    return values;
+}
+
+bool WorkloadGenerator::next(TraceEvent &event)
+{
+    if (produced == spec.operations)
+        return false;
+    ++produced;
+
+    double total = spec.insertRatio + spec.removeRatio + spec.scanRatio;
+    double pick = std::uniform_real_distribution<double>(0, total)(random);
+
+    if (pick < spec.scanRatio)
+    {
+        auto view = std::uniform_int_distribution<int>(0, 2)(random);
+        event = {static_cast<TraceOp>(static_cast<int>(TraceOp::IterateAscending) + view), 0};
+    }
+    else if (pick < spec.scanRatio + spec.removeRatio && !live.empty())
+    {
+        size_t index = std::uniform_int_distribution<size_t>(0, live.size() - 1)(random);
+        event = {TraceOp::Remove, live[index]};
+        live[index] = live.back(); // O(1) unordered erase
+        live.pop_back();
+    }
+    else
+    {
+        event = {TraceOp::Add, nextValue()};
+        live.push_back(event.value);
+    }
+    return true;
+}
+
+void WorkloadGenerator::writeTrace(const std::string &path)
+{
+    TraceWriter writer(path);
+    for (int32_t value : initialValues())
+    {
+        writer.record(TraceOp::Add, value);
+    }
+    TraceEvent event{};
+    while (next(event))
+    {
+        writer.record(event.op, event.value);
+    }
+    writer.flush();
+}
+
+const char *WorkloadGenerator::name(Distribution distribution)
+{
+    switch (distribution)
+    {
+    case Distribution::Uniform:
+        return "uniform";
+    case Distribution::Zipfian:
+        return "zipfian";
+    case Distribution::Presorted:
+        return "presorted";
+    case Distribution::ReverseSorted:
+        return "reverse-sorted";
+    case Distribution::PrimeHeavy:
+        return "prime-heavy";
+    case Distribution::DuplicateHeavy:
+        return "duplicate-heavy";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "WorkloadTrace.hpp"
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace ariel
+{
+
+    enum class Distribution
+    {
+        Uniform,
+        Zipfian,       // a few values are drawn far more often than the rest
+        Presorted,     // strictly increasing
+        ReverseSorted, // strictly decreasing
+        PrimeHeavy,    // most values are prime
+        DuplicateHeavy // values drawn from a small pool
+    };
+
+    struct WorkloadSpec
+    {
+        Distribution distribution = Distribution::Uniform;
+        size_t initialSize = 0;      // values handed out by initialValues() before the operation stream
+        size_t operations = 0;       // length of the operation stream
+        double insertRatio = 0.5;    // the three ratios are weights and need not sum to 1
+        double removeRatio = 0.4;
+        double scanRatio = 0.1;
+        int32_t valueRange = 1 << 30; // values are drawn from [0, valueRange)
+        double zipfSkew = 0.99;       // in (0, 1)
+        size_t duplicatePool = 64;
+        double primeShare = 0.9; // PrimeHeavy only
+        uint64_t seed = 1;
+    };
+
+    // Streams a synthetic operation mix as TraceEvents, so workloads can be replayed, written as
+    // traces or fed to the benchmark harness. Memory is proportional to the live element count
+    // (needed so removes always target present values), not to the stream length, so streams
+    // against containers of up to 10^8 elements are fine.
+    class WorkloadGenerator
+    {
+        WorkloadSpec spec;
+        std::mt19937_64 random;
+        std::vector<int32_t> live; // values currently in the container, in no particular order
+        size_t produced;
+        int64_t sequence; // next value of the sorted distributions
+
+        // Zipfian state, see Gray et al., "Quickly generating billion-record synthetic databases"
+        double zipfZetaN;
+        double zipfAlpha;
+        double zipfEta;
+
+        int32_t nextValue();
+        int32_t zipfValue();
+        static bool isPrime(int32_t value);
+
+    public:
+        explicit WorkloadGenerator(const WorkloadSpec &spec);
+
+        // Values for the initial bulk load, tracked as live
+        std::vector<int32_t> initialValues();
+
+        // Next operation, false once spec.operations were produced
+        bool next(TraceEvent &event);
+
+        // Writes the initial values as adds followed by the operation stream, for ./replay
+        void writeTrace(const std::string &path);
+
+        static const char *name(Distribution distribution);
+    };
+} // namespace ariel
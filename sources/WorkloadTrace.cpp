@@ -0,0 +1,93 @@
+#include "WorkloadTrace.hpp"
+#include <cstring>
+#include <stdexcept>
+
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    const char TRACE_MAGIC[4] = {'M', 'G', 'T', 'R'};
+    const size_t RECORD_SIZE = sizeof(uint8_t) + sizeof(int32_t);
+}
+
+/*------------------------------------------
+----------------TraceWriter-----------------
+--------------------------------------------*/
+
+TraceWriter::TraceWriter(const std::string &path) : out(path, std::ios::binary | std::ios::trunc), events(0)
+{
+    if (!out)
+        throw std::runtime_error("Cant open trace file for writing");
+    out.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    out.write(reinterpret_cast<const char *>(&VERSION), sizeof(VERSION));
+}
+
+void TraceWriter::record(TraceOp op, int32_t value)
+{
+    char record[RECORD_SIZE];
+    record[0] = static_cast<char>(op);
+    std::memcpy(record + 1, &value, sizeof(value));
+    out.write(record, sizeof(record));
+    ++events;
+}
+
+void TraceWriter::flush()
+{
+    out.flush();
+    if (!out)
+        throw std::runtime_error("Failed writing trace file");
+}
+
+size_t TraceWriter::recorded() const
+{
+    return events;
+}
+
+/*------------------------------------------
+-------------------------------------------*/
+
+/*------------------------------------------
+----------------TraceReader-----------------
+--------------------------------------------*/
+
+std::vector<TraceEvent> TraceReader::readAll(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in)
+        throw std::runtime_error("Cant open trace file");
+
+    auto fileSize = static_cast<size_t>(in.tellg());
+    in.seekg(0);
+
+    char magic[sizeof(TRACE_MAGIC)];
+    uint32_t version = 0;
+    size_t headerSize = sizeof(magic) + sizeof(version);
+    if (fileSize < headerSize || !in.read(magic, sizeof(magic)) || !in.read(reinterpret_cast<char *>(&version), sizeof(version)) ||
+        std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0 || version < 1 || version > TraceWriter::VERSION)
+        throw std::runtime_error("Not a valid trace file");
+    if ((fileSize - headerSize) % RECORD_SIZE != 0)
+        throw std::runtime_error("Trace file is truncated");
+
+    std::vector<char> raw(fileSize - headerSize);
+    in.read(raw.data(), static_cast<std::streamsize>(raw.size()));
+    if (!in)
+        throw std::runtime_error("Failed reading trace file");
+
+    // the last opcode every version knows
+    TraceOp lastOp = version == 1 ? TraceOp::IteratePrime : TraceOp::IterateDescending;
+    std::vector<TraceEvent> events(raw.size() / RECORD_SIZE);
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        const char *record = raw.data() + i * RECORD_SIZE;
+        auto op = static_cast<uint8_t>(record[0]);
+        if (op < static_cast<uint8_t>(TraceOp::Add) || op > static_cast<uint8_t>(lastOp))
+            throw std::runtime_error("Trace file holds an unknown operation");
+        events[i].op = static_cast<TraceOp>(op);
+        std::memcpy(&events[i].value, record + 1, sizeof(int32_t));
+    }
+    return events;
+}
+
+/*------------------------------------------
+-------------------------------------------*/
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ariel
+{
+
+    // Compact binary trace of the operations performed on a MagicalContainer:
+    // the 8 byte header "MGTR" + uint32 version, then one 5 byte record per operation
+    // (uint8 opcode, native-endian int32 value; the value is 0 for iterations).
+    enum class TraceOp : uint8_t
+    {
+        Add = 1,
+        Remove = 2,
+        IterateAscending = 3,
+        IterateCross = 4,
+        IteratePrime = 5,
+        IterateDescending = 6
+    };
+
+    struct TraceEvent
+    {
+        TraceOp op;
+        int32_t value;
+    };
+
+    class TraceWriter
+    {
+        std::ofstream out;
+        size_t events;
+
+    public:
+        // 2 added IterateDescending; readers accept every version up to their own
+        static constexpr uint32_t VERSION = 2;
+
+        explicit TraceWriter(const std::string &path);
+
+        void record(TraceOp op, int32_t value = 0);
+        void flush();
+        size_t recorded() const;
+    };
+
+    class TraceReader
+    {
+    public:
+        // Throws std::runtime_error on a missing, foreign or truncated trace
+        static std::vector<TraceEvent> readAll(const std::string &path);
+    };
+} // namespace ariel